@@ -0,0 +1,522 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "AccessLog.h"
+#include "HttpStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+
+/* -------------------------------------------------------------------------- */
+
+// A request, as copied by the thread serving it: the fields are
+// truncated to a fixed size, so that no memory is allocated
+struct AccessLog::Record {
+    enum {
+        ADDRESS_SIZE = 46, // INET6_ADDRSTRLEN
+        URI_SIZE = 256,
+        REFERER_SIZE = 128,
+        USER_AGENT_SIZE = 128
+    };
+
+    int64_t time; // usecs since the epoch
+    int64_t bytes;
+    uint16_t status;
+    HttpRequest::Method method;
+    HttpRequest::Version version;
+    uint16_t uriSize;
+    uint16_t refererSize;
+    uint16_t userAgentSize;
+    char address[ADDRESS_SIZE];
+    char uri[URI_SIZE];
+    char referer[REFERER_SIZE];
+    char userAgent[USER_AGENT_SIZE];
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+// Single producer, single consumer ring of records. The indices only
+// grow: the slot of an index is the index modulo the size.
+struct AccessLog::Ring {
+    enum { SIZE = HTTP_ACCESS_LOG_RING_SIZE };
+
+    static_assert((SIZE & (SIZE - 1)) == 0, "Ring size must be a power of 2");
+
+    Record records[SIZE];
+
+    // Written by the producer: the next record to fill in
+    alignas(64) std::atomic<uint64_t> head { 0 };
+    uint64_t cachedTail = 0; // last tail seen by the producer
+
+    // Written by the consumer: the next record to format
+    alignas(64) std::atomic<uint64_t> tail { 0 };
+
+    // Set when the producer thread terminates
+    std::atomic<bool> released { false };
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+
+/* -------------------------------------------------------------------------- */
+
+// Copies a string into a field of a record, truncating it
+uint16_t copyField(std::string_view value, char* field, size_t size) noexcept
+{
+    const size_t n = std::min(value.size(), size);
+
+    // An empty view may have no data at all
+    if (n)
+        ::memcpy(field, value.data(), n);
+
+    return uint16_t(n);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const char* methodName(HttpRequest::Method method) noexcept
+{
+    switch (method) {
+    case HttpRequest::Method::GET:
+        return "GET";
+    case HttpRequest::Method::HEAD:
+        return "HEAD";
+    case HttpRequest::Method::POST:
+        return "POST";
+    default:
+        return "-";
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const char* versionName(HttpRequest::Version version) noexcept
+{
+    switch (version) {
+    case HttpRequest::Version::HTTP_1_0:
+        return "HTTP/1.0";
+    case HttpRequest::Version::HTTP_1_1:
+        return "HTTP/1.1";
+    default:
+        return "-";
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the length of the well-formed UTF-8 sequence starting a
+// string, or zero if the string does not start with one (invalid,
+// overlong, surrogate, out of range or truncated sequence)
+size_t utf8SequenceSize(const unsigned char* s, size_t size) noexcept
+{
+    size_t n = 0;
+    unsigned char min = 0x80, max = 0xbf; // range of the second byte
+
+    if (s[0] >= 0xc2 && s[0] <= 0xdf) {
+        n = 2;
+    }
+    else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+        n = 3;
+        min = s[0] == 0xe0 ? 0xa0 : 0x80;
+        max = s[0] == 0xed ? 0x9f : 0xbf;
+    }
+    else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+        n = 4;
+        min = s[0] == 0xf0 ? 0x90 : 0x80;
+        max = s[0] == 0xf4 ? 0x8f : 0xbf;
+    }
+
+    if (!n || n > size || s[1] < min || s[1] > max)
+        return 0;
+
+    for (size_t i = 2; i < n; ++i) {
+        if (s[i] < 0x80 || s[i] > 0xbf)
+            return 0;
+    }
+
+    return n;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Appends a string escaping the quotes, the backslashes and the
+// control characters, either as Apache does for the CLF or as JSON
+// requires. JSON text must also be valid UTF-8: the bytes which are
+// not part of a well-formed sequence, including a sequence cut by the
+// truncation of a field, are replaced by U+FFFD
+void appendEscaped(std::string& output, const char* s, size_t size, bool json)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < size; ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+
+        if (json && c >= 0x80) {
+            const size_t n = utf8SequenceSize(
+                reinterpret_cast<const unsigned char*>(s + i), size - i);
+
+            if (n) {
+                output.append(s + i, n);
+                i += n - 1;
+            }
+            else {
+                output += "\\ufffd";
+            }
+        }
+        else if (c == '"' || c == '\\') {
+            output += '\\';
+            output += char(c);
+        }
+        else if (c < 0x20 || c == 0x7f) {
+            output += json ? "\\u00" : "\\x";
+            output += hex[c >> 4];
+            output += hex[c & 0xf];
+        }
+        else {
+            output += char(c);
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void appendQuoted(std::string& output, const char* s, size_t size, bool json)
+{
+    output += '"';
+    appendEscaped(output, s, size, json);
+    output += '"';
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace
+
+
+/* -------------------------------------------------------------------------- */
+
+auto AccessLog::getInstance() -> AccessLog&
+{
+    static AccessLog instance;
+    return instance;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+AccessLog::~AccessLog()
+{
+    if (_writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _stop = true;
+        }
+
+        _cond.notify_one();
+        _writer.join();
+    }
+
+    for (Ring* ring : _rings)
+        delete ring;
+
+    if (_file && _file != stdout)
+        ::fclose(_file);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool AccessLog::parseFormat(const std::string& name, Format& format)
+{
+    if (name == "common")
+        format = Format::COMMON;
+    else if (name == "combined")
+        format = Format::COMBINED;
+    else if (name == "json")
+        format = Format::JSON;
+    else
+        return false;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool AccessLog::open(const std::string& fileName, Format format)
+{
+    if (_file)
+        return false;
+
+    _file = fileName == "-" ? stdout : ::fopen(fileName.c_str(), "a");
+
+    if (!_file)
+        return false;
+
+    _format = format;
+    _writer = std::thread(&AccessLog::run, this);
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+AccessLog::Ring& AccessLog::getThreadRing()
+{
+    // Created by the first request logged by a thread, released to
+    // the writer when the thread terminates
+    struct ThreadRing {
+        Ring* ring = new Ring;
+
+        ThreadRing() {
+            getInstance().attach(ring);
+        }
+
+        ~ThreadRing() {
+            ring->released.store(true, std::memory_order_release);
+        }
+    };
+
+    thread_local ThreadRing threadRing;
+
+    return *threadRing.ring;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void AccessLog::attach(Ring* ring)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    _rings.push_back(ring);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void AccessLog::write(
+    const TcpSocket& socket,
+    const HttpRequest& request,
+    const HttpResponse& response) noexcept
+{
+    // Open before the server runs, so it is not going to change
+    if (!getInstance()._file)
+        return;
+
+    Ring& ring = getThreadRing();
+
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+    // The tail is read again only when the ring looks full
+    if (head - ring.cachedTail >= Ring::SIZE) {
+        ring.cachedTail = ring.tail.load(std::memory_order_acquire);
+
+        if (head - ring.cachedTail >= Ring::SIZE) {
+            HttpStats::countAccessLogDrop();
+            return;
+        }
+    }
+
+    Record& record = ring.records[head & (Ring::SIZE - 1)];
+
+    record.time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Body bytes, as %b of the CLF
+    record.bytes = response.getContent() || response.hasFileBody()
+        ? response.getBodySize()
+        : 0;
+
+    record.status = uint16_t(response.getStatusCode());
+    record.method = request.getMethod();
+    record.version = request.getVersion();
+
+    record.address[copyField(socket.getRemoteIpAddress(), 
+        record.address, Record::ADDRESS_SIZE - 1)] = 0;
+
+    record.uriSize = copyField(
+        request.getUri(), record.uri, Record::URI_SIZE);
+
+    if (getInstance()._format == Format::COMMON) {
+        record.refererSize = record.userAgentSize = 0;
+    }
+    else {
+        record.refererSize = copyField(request.getField("Referer"),
+            record.referer, Record::REFERER_SIZE);
+        record.userAgentSize = copyField(request.getField("User-Agent"),
+            record.userAgent, Record::USER_AGENT_SIZE);
+    }
+
+    ring.head.store(head + 1, std::memory_order_release);
+
+    // A burst of requests would fill the ring before the writer wakes
+    // up on its own: every half ring it is woken up earlier
+    if (((head + 1) & (Ring::SIZE / 2 - 1)) == 0)
+        getInstance()._cond.notify_one();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool AccessLog::drain(Ring& ring, std::string& output)
+{
+    // Read before the records: once released, no record follows
+    const bool released = ring.released.load(std::memory_order_acquire);
+
+    const uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+
+    for (; tail != head; ++tail)
+        format(ring.records[tail & (Ring::SIZE - 1)], output);
+
+    // The slots are given back once formatted
+    ring.tail.store(tail, std::memory_order_release);
+
+    return !released;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void AccessLog::run()
+{
+    std::string output;
+    std::vector<Ring*> rings;
+
+    std::unique_lock<std::mutex> lock(_mtx);
+
+    while (true) {
+        const bool stop = _cond.wait_for(lock,
+            std::chrono::milliseconds(HTTP_ACCESS_LOG_FLUSH_INTERVAL),
+            [this] { return _stop; });
+
+        rings = _rings;
+
+        // Rings are drained out of the lock, so that threads starting
+        // meanwhile are not delayed
+        lock.unlock();
+
+        output.clear();
+
+        std::vector<Ring*> released;
+
+        for (Ring* ring : rings) {
+            if (!drain(*ring, output))
+                released.push_back(ring);
+        }
+
+        if (!output.empty()) {
+            ::fwrite(output.data(), 1, output.size(), _file);
+            ::fflush(_file);
+        }
+
+        lock.lock();
+
+        for (Ring* ring : released) {
+            _rings.erase(std::find(_rings.begin(), _rings.end(), ring));
+            delete ring;
+        }
+
+        if (stop)
+            break;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void AccessLog::format(const Record& record, std::string& output) const
+{
+    const time_t seconds = time_t(record.time / 1000000);
+
+    tm t {};
+#ifdef WIN32
+    ::gmtime_s(&t, &seconds);
+#else
+    ::gmtime_r(&seconds, &t);
+#endif
+
+    char buffer[64];
+
+    if (_format == Format::JSON) {
+        ::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &t);
+
+        output += "{\"time\":\"";
+        output += buffer;
+        ::snprintf(buffer, sizeof(buffer), ".%06dZ\",\"remote_addr\":",
+            int(record.time % 1000000));
+        output += buffer;
+        appendQuoted(output, record.address, ::strlen(record.address), true);
+        output += ",\"method\":\"";
+        output += methodName(record.method);
+        output += "\",\"uri\":";
+        appendQuoted(output, record.uri, record.uriSize, true);
+        output += ",\"protocol\":\"";
+        output += versionName(record.version);
+        output += "\",\"status\":" + std::to_string(record.status);
+        output += ",\"bytes\":" + std::to_string(record.bytes);
+        output += ",\"referer\":";
+        appendQuoted(output, record.referer, record.refererSize, true);
+        output += ",\"user_agent\":";
+        appendQuoted(output, record.userAgent, record.userAgentSize, true);
+        output += "}\n";
+        return;
+    }
+
+    // host ident authuser [date] "request" status bytes
+    ::strftime(buffer, sizeof(buffer), "[%d/%b/%Y:%H:%M:%S +0000]", &t);
+
+    output += record.address;
+    output += " - - ";
+    output += buffer;
+    output += " \"";
+    output += methodName(record.method);
+    output += ' ';
+
+    appendEscaped(output, record.uri, record.uriSize, false);
+    output += ' ';
+    output += versionName(record.version);
+    output += "\" " + std::to_string(record.status) + " ";
+    output += record.bytes ? std::to_string(record.bytes) : "-";
+
+    // Missing fields are logged as "-"
+    if (_format == Format::COMBINED) {
+        output += ' ';
+
+        if (record.refererSize)
+            appendQuoted(output, record.referer, record.refererSize, false);
+        else
+            output += "\"-\"";
+
+        output += ' ';
+
+        if (record.userAgentSize)
+            appendQuoted(output, record.userAgent, record.userAgentSize, false);
+        else
+            output += "\"-\"";
+    }
+
+    output += '\n';
+}
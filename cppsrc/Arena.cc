@@ -0,0 +1,163 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "Arena.h"
+
+#include <cstdint>
+#include <new>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+
+/* -------------------------------------------------------------------------- */
+
+// Free blocks of HTTP_ARENA_BLOCK_SIZE bytes, kept by a thread
+class BlockPool {
+public:
+    ~BlockPool() {
+        while (_free)
+            ::operator delete(acquire());
+    }
+
+    void* acquire() {
+        if (!_free)
+            return ::operator new(HTTP_ARENA_BLOCK_SIZE);
+
+        FreeBlock* block = _free;
+        _free = block->next;
+        --_count;
+
+        return block;
+    }
+
+    void release(void* p) noexcept {
+        if (_count >= HTTP_ARENA_POOL_BLOCKS) {
+            ::operator delete(p);
+            return;
+        }
+
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        block->next = _free;
+        _free = block;
+        ++_count;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* _free = nullptr;
+    size_t _count = 0;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+thread_local BlockPool blockPool;
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace
+
+
+/* -------------------------------------------------------------------------- */
+
+Arena::~Arena()
+{
+    while (_blocks) {
+        Block* block = _blocks;
+        _blocks = block->next;
+        release(block);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void Arena::reset() noexcept
+{
+    if (!_blocks)
+        return;
+
+    // The first block is the last of the list
+    while (_blocks->next) {
+        Block* block = _blocks;
+        _blocks = block->next;
+        release(block);
+    }
+
+    _cursor = reinterpret_cast<char*>(_blocks + 1);
+    _end = reinterpret_cast<char*>(_blocks) + _blocks->size;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void* Arena::do_allocate(size_t bytes, size_t alignment)
+{
+    auto align = [alignment](char* p) {
+        const uintptr_t mask = uintptr_t(alignment) - 1;
+        return reinterpret_cast<char*>((uintptr_t(p) + mask) & ~mask);
+    };
+
+    char* p = align(_cursor);
+
+    if (!_cursor || size_t(_end - _cursor) < bytes + size_t(p - _cursor)) {
+        grow(bytes + alignment);
+        p = align(_cursor);
+    }
+
+    _cursor = p + bytes;
+
+    return p;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void Arena::grow(size_t bytes)
+{
+    void* p;
+    size_t size = HTTP_ARENA_BLOCK_SIZE;
+
+    // Larger requests get a block of their own, not pooled
+    if (bytes > HTTP_ARENA_BLOCK_SIZE - sizeof(Block)) {
+        size = sizeof(Block) + bytes;
+        p = ::operator new(size);
+    }
+    else {
+        p = blockPool.acquire();
+    }
+
+    Block* block = static_cast<Block*>(p);
+    block->next = _blocks;
+    block->size = size;
+    _blocks = block;
+
+    _cursor = reinterpret_cast<char*>(block + 1);
+    _end = reinterpret_cast<char*>(block) + size;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void Arena::release(Block* block) noexcept
+{
+    if (block->size == HTTP_ARENA_BLOCK_SIZE)
+        blockPool.release(block);
+    else
+        ::operator delete(block);
+}
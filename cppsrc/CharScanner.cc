@@ -0,0 +1,178 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "CharScanner.h"
+
+#include <algorithm>
+
+#ifdef HTTP_SERVER_SSE2_SUPPORT
+#include <immintrin.h>
+#endif
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+
+/* -------------------------------------------------------------------------- */
+
+// Kernels return the size of the data if no character is found
+using Kernel = size_t (*)(const char* data, size_t size, char c1, char c2);
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t findScalar(const char* data, size_t size, char c1, char c2) noexcept
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] == c1 || data[i] == c2)
+            return i;
+    }
+
+    return size;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef HTTP_SERVER_SSE2_SUPPORT
+
+size_t findSse2(const char* data, size_t size, char c1, char c2) noexcept
+{
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + i));
+
+        const unsigned mask = unsigned(_mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2))));
+
+        if (mask)
+            return i + size_t(__builtin_ctz(mask));
+    }
+
+    return i + findScalar(data + i, size - i, c1, c2);
+}
+
+#endif // HTTP_SERVER_SSE2_SUPPORT
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef HTTP_SERVER_AVX2_SUPPORT
+
+__attribute__((target("avx2")))
+size_t findAvx2(const char* data, size_t size, char c1, char c2) noexcept
+{
+    const __m256i v1 = _mm256_set1_epi8(c1);
+    const __m256i v2 = _mm256_set1_epi8(c2);
+
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        const __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + i));
+
+        const unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, v1), _mm256_cmpeq_epi8(v, v2))));
+
+        if (mask)
+            return i + size_t(__builtin_ctz(mask));
+    }
+
+    // Less than 32 bytes left
+    return i + findSse2(data + i, size - i, c1, c2);
+}
+
+#endif // HTTP_SERVER_AVX2_SUPPORT
+
+
+/* -------------------------------------------------------------------------- */
+
+struct KernelEntry {
+    Kernel kernel;
+    const char* name;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+KernelEntry selectKernel() noexcept
+{
+#ifdef HTTP_SERVER_AVX2_SUPPORT
+    // May run before the constructor initializing the CPU model
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return { findAvx2, "avx2" };
+#endif
+
+#ifdef HTTP_SERVER_SSE2_SUPPORT
+    return { findSse2, "sse2" };
+#else
+    return { findScalar, "scalar" };
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const KernelEntry selectedKernel = selectKernel();
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t CharScanner::find(
+    std::string_view s, char c1, char c2, size_t from) noexcept
+{
+    if (from >= s.size())
+        return npos;
+
+    const size_t pos = from
+        + selectedKernel.kernel(s.data() + from, s.size() - from, c1, c2);
+
+    return pos < s.size() ? pos : npos;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t CharScanner::findHeaderEnd(std::string_view s, size_t from) noexcept
+{
+    // Header lines are skipped by searching for their LF, each is
+    // then checked for being the last one of the CRLF CRLF sequence
+    for (size_t pos = find(s, '\n', std::max(from, size_t(3))); pos != npos;
+         pos = find(s, '\n', pos + 1))
+    {
+        if (s.compare(pos - 3, 4, "\r\n\r\n") == 0)
+            return pos - 3;
+    }
+
+    return npos;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const char* CharScanner::getKernelName() noexcept
+{
+    return selectedKernel.name;
+}
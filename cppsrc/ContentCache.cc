@@ -0,0 +1,143 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "ContentCache.h"
+#include "HttpStats.h"
+#include "Tools.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+ContentCache::ContentCache()
+{
+    setup(HTTP_CONTENT_CACHE_SIZE, HTTP_CONTENT_CACHE_ENTRY_SIZE);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+auto ContentCache::getInstance() -> ContentCache&
+{
+    static ContentCache instance;
+    return instance;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void ContentCache::setup(size_t budget, size_t maxEntrySize)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    _budget = budget;
+    _maxEntrySize = maxEntrySize;
+
+    _nodes.clear();
+    _lru.clear();
+    _usedBytes = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+ContentCache::Content ContentCache::read(const FileCache::Entry& fileEntry)
+{
+    std::shared_ptr<std::string> content(
+        new std::string(size_t(fileEntry.getSize()), '\0'));
+
+    size_t offset = 0;
+
+    while (offset < content->size()) {
+        int64_t len = Tools::readFileAt(fileEntry.getFd(),
+            &(*content)[offset], content->size() - offset, offset);
+
+        // File truncated or not readable
+        if (len <= 0)
+            return nullptr;
+
+        offset += size_t(len);
+    }
+
+    return content;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void ContentCache::erase(std::unordered_map<std::string, Node>::iterator it)
+{
+    _usedBytes -= it->second.content->size();
+    _lru.erase(it->second.lruPos);
+    _nodes.erase(it);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+ContentCache::Content ContentCache::get(const FileCache::Entry& fileEntry)
+{
+    const std::string& path = fileEntry.getPath();
+
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        if (size_t(fileEntry.getSize()) > _maxEntrySize
+            || size_t(fileEntry.getSize()) > _budget)
+        {
+            return nullptr;
+        }
+
+        auto it = _nodes.find(path);
+
+        if (it != _nodes.end()) {
+            Node& node = it->second;
+
+            if (node.modTime == fileEntry.getModTime()
+                && node.content->size() == size_t(fileEntry.getSize()))
+            {
+                _lru.splice(_lru.begin(), _lru, node.lruPos);
+                HttpStats::countCacheLookup(HttpStats::Cache::CONTENT, true);
+                return node.content;
+            }
+
+            // File has changed
+            erase(it);
+        }
+    }
+
+    HttpStats::countCacheLookup(HttpStats::Cache::CONTENT, false);
+
+    // File system is accessed out of the lock
+    Content content = read(fileEntry);
+
+    if (!content)
+        return content;
+
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    // Another connection may have loaded the same file meanwhile
+    auto it = _nodes.find(path);
+
+    if (it != _nodes.end())
+        erase(it);
+
+    while (!_lru.empty() && _usedBytes + content->size() > _budget)
+        erase(_nodes.find(_lru.back()));
+
+    Node& node = _nodes[path];
+    node.content = content;
+    node.modTime = fileEntry.getModTime();
+    node.lruPos = _lru.insert(_lru.begin(), path);
+
+    _usedBytes += content->size();
+
+    return content;
+}
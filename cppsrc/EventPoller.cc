@@ -0,0 +1,68 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "EventPoller.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include <errno.h>
+#include <unistd.h>
+
+
+/* -------------------------------------------------------------------------- */
+
+EventPoller::EventPoller()
+    : _epollFd(::epoll_create1(EPOLL_CLOEXEC))
+{
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+EventPoller::~EventPoller()
+{
+    if (isValid())
+        ::close(_epollFd);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool EventPoller::control(int op, const SocketFd& sd, uint32_t events) noexcept
+{
+    epoll_event ev {};
+    ev.events = events;
+    ev.data.fd = sd;
+
+    return ::epoll_ctl(_epollFd, op, sd, &ev) == 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int EventPoller::wait(std::vector<Event>& events, const TimeoutInterval& timeout)
+{
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
+
+    int nd = ::epoll_wait(
+        _epollFd, events.data(), int(events.size()), int(ms.count()));
+
+    // A signal interrupting the wait is not an error
+    if (nd < 0 && errno == EINTR)
+        return 0;
+
+    return nd;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
@@ -0,0 +1,200 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "FileCache.h"
+#include "HttpResponse.h"
+#include "HttpStats.h"
+#include "OsSocketSupport.h"
+
+#include <cstdio>
+
+#include <fcntl.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+/* -------------------------------------------------------------------------- */
+
+FileCache::Entry::~Entry()
+{
+    if (_fd >= 0)
+        ::close(_fd);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+FileCache::FileCache()
+{
+    setup(HTTP_FILE_CACHE_ENTRIES, HTTP_FILE_CACHE_TTL);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+auto FileCache::getInstance() -> FileCache&
+{
+    static FileCache instance;
+    return instance;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void FileCache::setup(size_t maxEntries, int ttl)
+{
+    _maxShardEntries = (maxEntries + SHARDS - 1) / SHARDS;
+    _ttl = std::chrono::seconds(ttl);
+
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.entries.clear();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+FileCache::Entry::Handle FileCache::open(
+    const std::string& fileName, const TimePoint& expiry)
+{
+#ifdef O_CLOEXEC
+    // Opened non-blocking so that a FIFO or a device under the web
+    // root cannot block the caller before it is rejected as not
+    // being a regular file
+    int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+#else
+    int fd = ::open(fileName.c_str(), O_RDONLY | O_BINARY);
+#endif
+
+    if (fd < 0)
+        return nullptr;
+
+    std::shared_ptr<Entry> entry(new Entry);
+    entry->_fd = fd;
+
+    struct stat rstat {};
+
+    if (::fstat(fd, &rstat) < 0 || (rstat.st_mode & S_IFMT) != S_IFREG)
+        return nullptr;
+
+#ifdef O_CLOEXEC
+    int flags = ::fcntl(fd, F_GETFL, 0);
+
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0)
+        return nullptr;
+#endif
+
+    entry->_path = fileName;
+    entry->_size = rstat.st_size;
+    entry->_modTime = rstat.st_mtime;
+    entry->_expiry = expiry;
+
+    char etag[64];
+    snprintf(etag, sizeof(etag), "W/\"%llx-%llx-%llx\"",
+        (unsigned long long)rstat.st_ino,
+        (unsigned long long)rstat.st_size,
+        (unsigned long long)rstat.st_mtime);
+
+    entry->_etag = etag;
+
+    std::string::size_type pos = fileName.find_last_of("./");
+
+    entry->_ext = pos != std::string::npos && fileName[pos] == '.'
+        ? fileName.substr(pos)
+        : ".";
+
+    HttpResponse::formatFileHeader(entry->_header, *entry);
+    HttpResponse::formatEncodedHeader(entry->_encodedHeader, *entry);
+
+    return entry;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void FileCache::evict(Shard& shard, const TimePoint& now)
+{
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+        if (it->second->_expiry <= now)
+            it = shard.entries.erase(it);
+        else
+            ++it;
+    }
+
+    // Not enough expired entries: any entry is as good as another
+    if (!shard.entries.empty() && shard.entries.size() >= _maxShardEntries)
+        shard.entries.erase(shard.entries.begin());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+FileCache::Entry::Handle FileCache::get(
+    std::string_view path, bool cacheMissing)
+{
+    // The maps are searched by a key of the thread, whose capacity
+    // grows to fit the paths, so that a lookup allocates no memory
+    thread_local std::string fileName;
+    fileName.assign(path.data(), path.size());
+
+    const TimePoint now = std::chrono::steady_clock::now();
+
+    Shard& shard = _shards[std::hash<std::string>()(fileName) % SHARDS];
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+
+        auto it = shard.entries.find(fileName);
+
+        // A missing file is cached as an entry with no descriptor
+        if (it != shard.entries.end() && now < it->second->_expiry) {
+            HttpStats::countCacheLookup(HttpStats::Cache::FILE, true);
+            return it->second->_fd >= 0 ? it->second : nullptr;
+        }
+    }
+
+    HttpStats::countCacheLookup(HttpStats::Cache::FILE, false);
+
+    // File system is accessed out of the lock
+    Entry::Handle entry = open(fileName, now + _ttl);
+
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    if (!entry && !cacheMissing) {
+        shard.entries.erase(fileName);
+        return entry;
+    }
+
+    if (!_maxShardEntries)
+        return entry;
+
+    auto it = shard.entries.find(fileName);
+
+    if (it == shard.entries.end() && shard.entries.size() >= _maxShardEntries)
+        evict(shard, now);
+
+    if (entry) {
+        shard.entries[fileName] = entry;
+    }
+    else {
+        std::shared_ptr<Entry> missing(new Entry);
+        missing->_path = fileName;
+        missing->_expiry = now + _ttl;
+        shard.entries[fileName] = missing;
+    }
+
+    return entry;
+}
@@ -0,0 +1,289 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "GzipCache.h"
+
+#ifdef HTTP_SERVER_ZLIB_SUPPORT
+
+#include "HttpResponse.h"
+#include "HttpStats.h"
+#include "MimeTypes.h"
+#include "Tools.h"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+
+/* -------------------------------------------------------------------------- */
+
+GzipCache::GzipCache()
+{
+    setup(HTTP_GZIP_CACHE_SIZE);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+GzipCache::~GzipCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+
+    _cond.notify_all();
+
+    if (_worker.joinable())
+        _worker.join();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+auto GzipCache::getInstance() -> GzipCache&
+{
+    static GzipCache instance;
+    return instance;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void GzipCache::setup(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    _budget = budget;
+
+    _nodes.clear();
+    _lru.clear();
+    _usedBytes = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool GzipCache::isCompressible(const FileCache::Entry& fileEntry)
+{
+    if (fileEntry.getSize() < HTTP_GZIP_MIN_SIZE
+        || fileEntry.getSize() > HTTP_GZIP_MAX_SIZE)
+    {
+        return false;
+    }
+
+    const std::string_view type = MimeTypes::lookup(fileEntry.getExt());
+
+    auto endsWith = [&type](std::string_view suffix) {
+        return type.size() >= suffix.size()
+            && type.substr(type.size() - suffix.size()) == suffix;
+    };
+
+    // Text formats, other types are likely compressed already
+    return type.substr(0, 5) == "text/"
+        || type == "application/javascript"
+        || type == "application/json"
+        || type == "application/xml"
+        || endsWith("+xml")
+        || endsWith("+json");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+GzipCache::Handle GzipCache::get(const FileCache::Entry::Handle& fileEntry)
+{
+    const std::string& path = fileEntry->getPath();
+
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    if (!_budget)
+        return nullptr;
+
+    auto it = _nodes.find(path);
+
+    if (it != _nodes.end()) {
+        Node& node = it->second;
+
+        if (node.modTime == fileEntry->getModTime()
+            && node.size == fileEntry->getSize())
+        {
+            _lru.splice(_lru.begin(), _lru, node.lruPos);
+            HttpStats::countCacheLookup(HttpStats::Cache::GZIP, true);
+            return node.variant;
+        }
+
+        // File has changed
+        erase(it);
+    }
+
+    HttpStats::countCacheLookup(HttpStats::Cache::GZIP, false);
+
+    // Queue the compression, unless already queued
+    if (_pending.size() < MAX_PENDING && _pendingPaths.insert(path).second) {
+        _pending.push_back(fileEntry);
+
+        if (!_worker.joinable())
+            _worker = std::thread(&GzipCache::run, this);
+
+        _cond.notify_one();
+    }
+
+    return nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void GzipCache::run()
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+
+    while (true) {
+        _cond.wait(lock, [this] { return _stop || !_pending.empty(); });
+
+        if (_stop)
+            break;
+
+        FileCache::Entry::Handle fileEntry = _pending.front();
+        _pending.pop_front();
+
+        // Files are compressed out of the lock
+        lock.unlock();
+        Handle variant = compress(*fileEntry);
+        lock.lock();
+
+        _pendingPaths.erase(fileEntry->getPath());
+
+        insert(*fileEntry, variant);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+GzipCache::Handle GzipCache::compress(const FileCache::Entry& fileEntry)
+{
+    // A file which cannot be compressed, or is not worth the effort,
+    // gets an empty content, so that it is not compressed again until
+    // it changes
+    std::shared_ptr<Variant> variant(new Variant);
+
+    z_stream zs {};
+
+    // Window bits beyond 15 select the gzip format
+    if (deflateInit2(&zs, HTTP_GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8,
+        Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return variant;
+    }
+
+    const int64_t size = fileEntry.getSize();
+
+    std::string output(deflateBound(&zs, uLong(size)), '\0');
+    zs.next_out = reinterpret_cast<Bytef*>(&output[0]);
+    zs.avail_out = uInt(output.size());
+
+    std::unique_ptr<char[]> buffer(new char[HTTP_SERVER_RX_BUF_SIZE]);
+    int64_t offset = 0;
+    int ret = Z_OK;
+
+    while (ret == Z_OK) {
+        size_t len = size_t(std::min(
+            int64_t(HTTP_SERVER_RX_BUF_SIZE), size - offset));
+
+        if (len > 0) {
+            int64_t rlen = Tools::readFileAt(
+                fileEntry.getFd(), buffer.get(), len, offset);
+
+            // File truncated or not readable
+            if (rlen <= 0)
+                break;
+
+            len = size_t(rlen);
+            offset += rlen;
+        }
+
+        zs.next_in = reinterpret_cast<Bytef*>(buffer.get());
+        zs.avail_in = uInt(len);
+
+        ret = deflate(&zs, offset < size ? Z_NO_FLUSH : Z_FINISH);
+    }
+
+    deflateEnd(&zs);
+
+    // File truncated or not readable, or deflate failure
+    if (ret != Z_STREAM_END)
+        return variant;
+
+    output.resize(zs.total_out);
+
+    if (output.size() >= size_t(size))
+        return variant;
+
+    // W/"inode-size-mtime" becomes W/"inode-size-mtime-gz"
+    variant->etag = fileEntry.getETag();
+    variant->etag.insert(variant->etag.size() - 1, "-gz");
+
+    HttpResponse::formatFileHeader(variant->header, int64_t(output.size()),
+        fileEntry.getModTime(), variant->etag, fileEntry.getExt(), "gzip");
+
+    variant->content = std::make_shared<const std::string>(std::move(output));
+
+    return variant;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void GzipCache::insert(const FileCache::Entry& fileEntry, Handle variant)
+{
+    const std::string& path = fileEntry.getPath();
+
+    // The cache may have been reconfigured meanwhile
+    const size_t size = variant->content ? variant->content->size() : 0;
+
+    if (size > _budget)
+        return;
+
+    auto it = _nodes.find(path);
+
+    if (it != _nodes.end())
+        erase(it);
+
+    while (!_lru.empty() && _usedBytes + size > _budget)
+        erase(_nodes.find(_lru.back()));
+
+    Node& node = _nodes[path];
+    node.variant = variant->content ? variant : nullptr;
+    node.modTime = fileEntry.getModTime();
+    node.size = fileEntry.getSize();
+    node.lruPos = _lru.insert(_lru.begin(), path);
+
+    _usedBytes += size;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void GzipCache::erase(std::unordered_map<std::string, Node>::iterator it)
+{
+    if (it->second.variant)
+        _usedBytes -= it->second.variant->content->size();
+
+    _lru.erase(it->second.lruPos);
+    _nodes.erase(it);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_ZLIB_SUPPORT
@@ -0,0 +1,170 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpClock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpClock::Slot HttpClock::_slots[HttpClock::SLOTS];
+std::atomic<time_t> HttpClock::_currentSecond(0);
+std::atomic<time_t> HttpClock::_publishedSecond(0);
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpClock::formatDate(time_t t, char* date) noexcept
+{
+    static const char* const days[] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+    };
+
+    static const char* const months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+
+    struct tm gmt {};
+
+#ifdef WIN32
+    ::gmtime_s(&gmt, &t);
+#else
+    ::gmtime_r(&t, &gmt);
+#endif
+
+    // The format has room for four digits of year only
+    const int year = std::min(std::max(gmt.tm_year + 1900, 0), 9999);
+
+    snprintf(date, DATE_SIZE + 1, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+        days[gmt.tm_wday], gmt.tm_mday, months[gmt.tm_mon],
+        year, gmt.tm_hour, gmt.tm_min, gmt.tm_sec);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpClock::parseDate(std::string_view date, time_t& t) noexcept
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    if (date.size() != DATE_SIZE)
+        return false;
+
+    // The date is copied, as the view is not null-terminated
+    char text[DATE_SIZE + 1];
+    date.copy(text, DATE_SIZE);
+    text[DATE_SIZE] = '\0';
+
+    char month[4] = { 0 };
+    int day = 0, year = 0, hour = 0, min = 0, sec = 0;
+
+    // e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+    if (sscanf(text + 5, "%2d %3s %4d %2d:%2d:%2d GMT",
+        &day, month, &year, &hour, &min, &sec) != 6)
+    {
+        return false;
+    }
+
+    const char* pos = strstr(months, month);
+
+    if (!pos || (pos - months) % 3 || day < 1 || day > 31 
+        || hour > 23 || min > 59 || sec > 60)
+    {
+        return false;
+    }
+
+    int mon = int(pos - months) / 3 + 1;
+
+    // Days from the epoch to the civil date (proleptic Gregorian 
+    // calendar), computed as gmtime() inverse, which is not portable
+    year -= mon <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int yoe = year - era * 400;
+    const int doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const int64_t days = int64_t(era) * 146097 + doe - 719468;
+
+    t = time_t(days * 86400 + hour * 3600 + min * 60 + sec);
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpClock::update(time_t now) noexcept
+{
+    time_t last = _currentSecond.load(std::memory_order_relaxed);
+
+    // Only one thread formats the date of a given second
+    if (now <= last || !_currentSecond.compare_exchange_strong(last, now))
+        return;
+
+    uint64_t words[SLOT_WORDS] = { 0 };
+    formatDate(now, reinterpret_cast<char*>(words));
+
+    // The slot is the one of the second, so that writers of different
+    // seconds do not share it even if a slow one is still writing
+    Slot& slot = _slots[now % SLOTS];
+
+    slot.seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (int i = 0; i < SLOT_WORDS; ++i)
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+
+    slot.seq.fetch_add(1, std::memory_order_release);
+
+    // A slow writer of an earlier second must not publish its date
+    // over a later one
+    time_t published = _publishedSecond.load(std::memory_order_relaxed);
+
+    while (published < now && !_publishedSecond.compare_exchange_weak(
+        published, now, std::memory_order_release))
+    {
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpClock::getDate(char* date) noexcept
+{
+    update(::time(nullptr));
+
+    uint64_t words[SLOT_WORDS];
+
+    while (true) {
+        const Slot& slot = 
+            _slots[_publishedSecond.load(std::memory_order_acquire) % SLOTS];
+
+        unsigned seq = slot.seq.load(std::memory_order_acquire);
+
+        // Slot being written or not written yet
+        if (seq & 1 || !seq)
+            continue;
+
+        for (int i = 0; i < SLOT_WORDS; ++i)
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.seq.load(std::memory_order_relaxed) == seq)
+            break;
+    }
+
+    memcpy(date, words, DATE_SIZE);
+    date[DATE_SIZE] = '\0';
+}
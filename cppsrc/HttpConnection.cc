@@ -0,0 +1,397 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpConnection.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include "AccessLog.h"
+#include "CharScanner.h"
+#include "HttpClock.h"
+
+#include <errno.h>
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpConnection::HttpConnection(
+    TcpSocket::Handle socketHandle,
+    const std::string& webRootPath,
+    bool verboseModeOn,
+    std::ostream& logger)
+    : _socketHandle(socketHandle)
+    , _webRootPath(webRootPath)
+    , _verboseModeOn(verboseModeOn)
+    , _logger(logger)
+{
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string HttpConnection::transactionId() const
+{
+    return "[" + std::to_string(getSocketFd()) + "] " + "["
+        + HttpClock::getDate() + "]";
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::updateTimer(
+    TimerWheel& timers, const HttpTimeouts& timeouts)
+{
+    if (_state == State::CLOSED) {
+        _stats.setIdle(false);
+        _timer.cancel();
+        return;
+    }
+
+    // A new connection is waiting for the header of its first request
+    const State phase = _state == State::IDLE && !_requestCount
+        ? State::READING_HEADER
+        : _state;
+
+    _stats.setIdle(phase == State::IDLE);
+
+    // Any activity postpones the deadline, except for the header one,
+    // which runs from the first byte of the request
+    if (_timer.isPending() && phase == _timerState 
+        && _requestCount == _timerRequestCount
+        && (phase == State::READING_HEADER 
+            || _lastActivity == _timerActivity))
+    {
+        return;
+    }
+
+    std::chrono::seconds timeout = timeouts.send;
+
+    if (phase == State::IDLE)
+        timeout = timeouts.idle;
+    else if (phase == State::READING_HEADER)
+        timeout = timeouts.header;
+
+    timers.schedule(_timer, timeout, _lastActivity);
+
+    _timerState = phase;
+    _timerActivity = _lastActivity;
+    _timerRequestCount = _requestCount;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::closeBody() noexcept
+{
+    _bodyFile.reset();
+    _bodyOffset = _bodyEnd = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::onRecvEvent()
+{
+    // While a response is in progress the input is left in the socket.
+    // Events are edge-triggered, so remember to come back to it once
+    // the transmission is completed.
+    if (_state == State::SENDING_HEADER || _state == State::SENDING_BODY) {
+        _recvPending = true;
+        return;
+    }
+
+    _recvPending = false;
+
+    char buffer[HTTP_SERVER_RX_BUF_SIZE];
+
+    while (_state == State::IDLE || _state == State::READING_HEADER) {
+        processInput();
+
+        // Responses to pipelined requests are queued until the input
+        // is drained; a body sent from file closes the batch
+        if (isBatchFull()) {
+            sendResponse();
+            continue;
+        }
+
+        if (_state == State::CLOSED)
+            break;
+
+        int ret = _socketHandle->recv(buffer, sizeof(buffer));
+
+        if (ret > 0) {
+            _rxBuffer.append(buffer, ret);
+            _state = State::READING_HEADER;
+            _lastActivity = std::chrono::steady_clock::now();
+        }
+        else if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        else if (ret == 0 && !_txQueue.empty()) {
+            // Remote peer has finished sending: 
+            // answer before closing the connection
+            sendResponse();
+        }
+        else {
+            // Connection closed by remote peer or broken
+            close();
+        }
+    }
+
+    // Input drained: transmit the queued responses by a single write
+    if (_state == State::IDLE || _state == State::READING_HEADER)
+        sendResponse();
+
+    // Socket has not been drained yet
+    if (_state == State::SENDING_HEADER || _state == State::SENDING_BODY)
+        _recvPending = true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::onSendEvent()
+{
+    if (_state != State::SENDING_HEADER && _state != State::SENDING_BODY)
+        return;
+
+    sendResponse();
+
+    // Transmission completed: resume processing of input
+    if (_state == State::IDLE || _state == State::READING_HEADER) {
+        if (_recvPending || !_rxBuffer.empty())
+            onRecvEvent();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::onRecvData(const char* data, size_t size)
+{
+    _rxBuffer.append(data, size);
+    _lastActivity = std::chrono::steady_clock::now();
+
+    // Data keeps being received while responses are transmitted:
+    // a peer flooding the connection is dropped
+    if (_rxBuffer.size() > HTTP_SERVER_MAX_HEADER_SIZE * HTTP_SERVER_PIPELINE_DEPTH) {
+        close();
+        return;
+    }
+
+    if (_state == State::IDLE)
+        _state = State::READING_HEADER;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int HttpConnection::advance(TransportSocket::Buffer* buffers, int maxCount)
+{
+    if (_state == State::SENDING_BODY) {
+        sendBody();
+
+        if (_state == State::SENDING_BODY)
+            return 0;
+    }
+
+    if (_state == State::IDLE || _state == State::READING_HEADER) {
+        processInput();
+
+        if (_txQueue.empty()) {
+            // Nothing left to answer
+            if (_peerClosed && _state != State::CLOSED)
+                close();
+
+            return 0;
+        }
+
+        _state = State::SENDING_HEADER;
+    }
+
+    if (_state != State::SENDING_HEADER)
+        return 0;
+
+    return _txQueue.fill(buffers, maxCount);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::onSent(size_t bytes)
+{
+    _txQueue.consume(bytes);
+    _lastActivity = std::chrono::steady_clock::now();
+
+    if (_txQueue.empty())
+        onQueueSent();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::prepareResponse(std::string_view header)
+{
+    ++_requestCount;
+
+    const TimePoint received = std::chrono::steady_clock::now();
+
+    HttpRequest request;
+
+    // A malformed request line leaves the method unknown,
+    // so that the response will be an error
+    request.parse(header);
+
+    if (_verboseModeOn)
+        request.dump(_logger, transactionId());
+
+    HttpResponse response(request, _webRootPath, _arena);
+
+    HttpStats::countRequest(request.getMethod(), response.getStatusCode());
+    AccessLog::write(*_socketHandle, request, response);
+
+    closeBody();
+
+    // A body held in memory is sent together with the header
+    _txQueue.push(response, received);
+
+    if (response.hasFileBody()) {
+        _bodyFile = response.getFileEntry();
+        _bodyOffset = off_t(response.getBodyOffset());
+        _bodyEnd = _bodyOffset + off_t(response.getBodySize());
+        _bodyRequestTime = received;
+    }
+
+    if (_verboseModeOn)
+        response.dump(_logger, transactionId());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::processInput()
+{
+    while ((_state == State::IDLE || _state == State::READING_HEADER)
+        && !isBatchFull())
+    {
+        std::string::size_type pos = CharScanner::findHeaderEnd(_rxBuffer);
+
+        if (pos == std::string::npos) {
+            if (_rxBuffer.size() > HTTP_SERVER_MAX_HEADER_SIZE)
+                close();
+
+            break;
+        }
+
+        // Keep the CRLF of the last header line, drop the empty line.
+        // The request refers to the buffer, so the header is dropped
+        // once the response is ready.
+        prepareResponse(std::string_view(_rxBuffer).substr(0, pos + 2));
+        _rxBuffer.erase(0, pos + 4);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::onQueueSent() noexcept
+{
+    _arena.reset();
+
+    if (_bodyFile)
+        _state = State::SENDING_BODY;
+    else
+        _state = _rxBuffer.empty() ? State::IDLE : State::READING_HEADER;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::sendResponse()
+{
+    if (_state == State::IDLE || _state == State::READING_HEADER) {
+        if (_txQueue.empty())
+            return;
+
+        _state = State::SENDING_HEADER;
+    }
+
+    // The headers are gathered with the bodies held in memory, or 
+    // corked when followed by a body sent from file
+    const int flags = getSendFlags();
+
+    while (_state == State::SENDING_HEADER) {
+        int64_t ret = _txQueue.send(*_socketHandle, flags);
+
+        if (ret > 0) {
+            _lastActivity = std::chrono::steady_clock::now();
+
+            if (_txQueue.empty())
+                onQueueSent();
+        }
+        else if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        else {
+            close();
+            return;
+        }
+    }
+
+    sendBody();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpConnection::sendBody()
+{
+    while (_state == State::SENDING_BODY) {
+        if (_bodyOffset >= _bodyEnd) {
+            HttpStats::countResponse(
+                std::chrono::steady_clock::now() - _bodyRequestTime);
+
+            closeBody();
+            _state = _rxBuffer.empty() ? State::IDLE : State::READING_HEADER;
+            break;
+        }
+
+        ssize_t ret = _socketHandle->sendFile(
+            _bodyFile->getFd(), _bodyOffset, size_t(_bodyEnd - _bodyOffset));
+
+        if (ret > 0) {
+            _lastActivity = std::chrono::steady_clock::now();
+            HttpStats::countBytesSent(uint64_t(ret));
+        }
+        else if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        else {
+            // Error or file truncated after its size was sent
+            close();
+            return;
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
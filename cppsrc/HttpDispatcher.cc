@@ -0,0 +1,276 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpDispatcher.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include "HttpStats.h"
+
+#include <sys/eventfd.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpDispatcher::~HttpDispatcher()
+{
+    if (_wakeFd >= 0)
+        ::close(_wakeFd);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpDispatcher::open()
+{
+    _poller = EventPoller::create();
+
+    if (!_poller || !_poller->isValid()) {
+        _poller.reset();
+        return false;
+    }
+
+    if (_wakeFd < 0)
+        _wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (_wakeFd < 0
+        || !_listener.setNonBlockingMode()
+        || !_poller->add(_listener.getSocketFd(), EPOLLIN)
+        || !_poller->add(_wakeFd, EPOLLIN))
+    {
+        _poller.reset();
+        return false;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpDispatcher::run()
+{
+    if (!_poller && !open())
+        return false;
+
+    const SocketFd listenerFd = _listener.getSocketFd();
+
+    std::vector<EventPoller::Event> events(HTTP_REACTOR_MAX_EVENTS);
+
+    while (true) {
+        // Timers are checked on every tick while any is pending
+        int nd = _poller->wait(events, _timers.empty()
+            ? TimerWheel::Duration(std::chrono::seconds(1))
+            : _timers.getResolution());
+
+        if (nd < 0)
+            return false;
+
+        for (int i = 0; i < nd; ++i) {
+            const SocketFd sd = events[i].data.fd;
+
+            if (sd == listenerFd) {
+                acceptConnections();
+                continue;
+            }
+
+            if (sd == _wakeFd) {
+                resumeConnections();
+                continue;
+            }
+
+            auto it = _connections.find(sd);
+
+            // Connections being served have no timer, nor are monitored
+            if (it == _connections.end() 
+                || !it->second->getTimer().isPending()) 
+            {
+                continue;
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                closeConnection(it);
+            else
+                onRecvEvent(it);
+        }
+
+        expireConnections();
+    }
+
+    // Ok, following instruction won't be ever executed
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpDispatcher::acceptConnections()
+{
+    // Drain the queue of pending connections
+    while (true) {
+        TcpSocket::Handle handle = _listener.accept();
+
+        if (!handle) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            HttpStats::countAcceptError();
+
+            if (errno == ECONNABORTED)
+                continue;
+
+            // Resources exhausted: the listener is not monitored for
+            // a while, as it would be reported as ready again at once
+            _poller->modify(_listener.getSocketFd(), 0);
+            _timers.schedule(_acceptTimer,
+                std::chrono::milliseconds(HTTP_SERVER_ACCEPT_BACKOFF));
+            break;
+        }
+
+        monitor(_connections.emplace(handle->getSocketFd(),
+            HttpServerTask::create(_verboseModeOn, _logger, handle,
+                _webRootPath, _timeouts)).first);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpDispatcher::monitor(ConnectionMap::iterator it)
+{
+    HttpServerTask& task = *it->second;
+
+    if (!_poller->add(it->first, EPOLLIN | EPOLLRDHUP)) {
+        task.close();
+        _connections.erase(it);
+        return;
+    }
+
+    // A request header is timed from its first byte on, or from the
+    // connection on for the first request
+    _timers.schedule(task.getTimer(),
+        task.isIdle() ? _timeouts.idle : _timeouts.header);
+
+    task.updateStats();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpDispatcher::onRecvEvent(ConnectionMap::iterator it)
+{
+    HttpServerTask* task = it->second.get();
+    const bool idle = task->isIdle();
+
+    if (!task->receive()) {
+        closeConnection(it);
+        return;
+    }
+
+    if (!task->hasPendingRequest()) {
+        if (idle && !task->isIdle()) {
+            _timers.schedule(task->getTimer(), _timeouts.header);
+            task->updateStats();
+        }
+
+        return;
+    }
+
+    // The connection is left to the worker until it hands it back;
+    // being referred by a plain pointer, the task is not allocated
+    _poller->remove(it->first);
+    task->getTimer().cancel();
+
+    _threadPool.submit([this, task]() {
+        task->serve();
+        release(task);
+    });
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpDispatcher::release(HttpServerTask* task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _released.push_back(task);
+    }
+
+    const uint64_t count = 1;
+    ssize_t ret = ::write(_wakeFd, &count, sizeof(count));
+    (void)ret;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpDispatcher::resumeConnections()
+{
+    uint64_t count = 0;
+    ssize_t ret = ::read(_wakeFd, &count, sizeof(count));
+    (void)ret;
+
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _resumed.swap(_released);
+    }
+
+    for (HttpServerTask* task : _resumed) {
+        auto it = _connections.find(task->getSocketFd());
+
+        if (task->isClosed())
+            _connections.erase(it);
+        else
+            monitor(it);
+    }
+
+    _resumed.clear();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpDispatcher::expireConnections()
+{
+    auto onExpired = [this](TimerWheel::Timer& timer) {
+        if (&timer == &_acceptTimer) {
+            _poller->modify(_listener.getSocketFd(), EPOLLIN);
+            return;
+        }
+
+        auto& task = *static_cast<HttpServerTask*>(timer.getContext());
+        auto it = _connections.find(task.getSocketFd());
+
+        if (it != _connections.end())
+            closeConnection(it);
+    };
+
+    _timers.advance(TimerWheel::Clock::now(), onExpired);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpDispatcher::closeConnection(ConnectionMap::iterator it)
+{
+    _poller->remove(it->first);
+    it->second->close();
+    _connections.erase(it);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
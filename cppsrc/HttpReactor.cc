@@ -0,0 +1,187 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpReactor.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include "HttpStats.h"
+#include "Tools.h"
+
+#include <vector>
+
+#include <errno.h>
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpReactor::open()
+{
+    _poller = EventPoller::create();
+
+    if (!_poller || !_poller->isValid()) {
+        _poller.reset();
+        return false;
+    }
+
+    if (!_listener.setNonBlockingMode() 
+        || !_poller->add(_listener.getSocketFd(), EPOLLIN)) 
+    {
+        _poller.reset();
+        return false;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpReactor::run()
+{
+    if (!_poller && !open())
+        return false;
+
+    const SocketFd listenerFd = _listener.getSocketFd();
+
+    std::vector<EventPoller::Event> events(HTTP_REACTOR_MAX_EVENTS);
+
+    while (true) {
+        // Timers are checked on every tick while any is pending
+        int nd = _poller->wait(events, _timers.empty() 
+            ? TimerWheel::Duration(std::chrono::seconds(1))
+            : _timers.getResolution());
+
+        if (nd < 0)
+            return false;
+
+        for (int i = 0; i < nd; ++i) {
+            const SocketFd sd = events[i].data.fd;
+            const uint32_t ev = events[i].events;
+
+            if (sd == listenerFd) {
+                acceptConnections();
+                continue;
+            }
+
+            auto it = _connections.find(sd);
+
+            if (it == _connections.end())
+                continue;
+
+            HttpConnection& connection = *it->second;
+
+            if (ev & (EPOLLERR | EPOLLHUP)) {
+                connection.close();
+            }
+            else {
+                if (ev & (EPOLLIN | EPOLLRDHUP))
+                    connection.onRecvEvent();
+
+                if (ev & EPOLLOUT)
+                    connection.onSendEvent();
+            }
+
+            if (connection.getState() == HttpConnection::State::CLOSED)
+                closeConnection(it);
+            else
+                connection.updateTimer(_timers, _timeouts);
+        }
+
+        expireConnections();
+    }
+
+    // Ok, following instruction won't be ever executed
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpReactor::acceptConnections()
+{
+    // Drain the queue of pending connections
+    while (true) {
+        TcpSocket::Handle handle = _listener.accept(true);
+
+        if (!handle) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            HttpStats::countAcceptError();
+
+            if (errno == ECONNABORTED)
+                continue;
+
+            // Resources exhausted: the listener is not monitored for
+            // a while, as it would be reported as ready again at once
+            _poller->modify(_listener.getSocketFd(), 0);
+            _timers.schedule(_acceptTimer,
+                std::chrono::milliseconds(HTTP_SERVER_ACCEPT_BACKOFF));
+            break;
+        }
+
+        const SocketFd sd = handle->getSocketFd();
+
+        // Both directions are registered once: being edge-triggered,
+        // the connection is only notified about state transitions
+        if (!_poller->add(sd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET))
+            continue;
+
+        HttpConnection::Handle connection = HttpConnection::create(
+            handle, _webRootPath, _verboseModeOn, _logger);
+
+        connection->updateTimer(_timers, _timeouts);
+
+        _connections[sd] = connection;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpReactor::expireConnections()
+{
+    auto onExpired = [this](TimerWheel::Timer& timer) {
+        if (&timer == &_acceptTimer) {
+            _poller->modify(_listener.getSocketFd(), EPOLLIN);
+            return;
+        }
+
+        auto& connection = *static_cast<HttpConnection*>(timer.getContext());
+        auto it = _connections.find(connection.getSocketFd());
+
+        if (it != _connections.end())
+            closeConnection(it);
+    };
+
+    _timers.advance(TimerWheel::Clock::now(), onExpired);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpReactor::ConnectionMap::iterator HttpReactor::closeConnection(
+    ConnectionMap::iterator it)
+{
+    _poller->remove(it->first);
+
+    if (_verboseModeOn)
+        Tools::writeLog(_logger, "[" + std::to_string(it->first)
+            + "] ---- http connection closed\n\n");
+
+    return _connections.erase(it);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
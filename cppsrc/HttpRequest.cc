@@ -10,36 +10,207 @@
 /* -------------------------------------------------------------------------- */
 
 #include "HttpRequest.h"
+#include "CharScanner.h"
+#include "Tools.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+
+/* -------------------------------------------------------------------------- */
+
+bool isSpace(char c) noexcept
+{
+    return c == ' ' || c == '\t';
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view trim(std::string_view s) noexcept
+{
+    while (!s.empty() && isSpace(s.front()))
+        s.remove_prefix(1);
+
+    while (!s.empty() && isSpace(s.back()))
+        s.remove_suffix(1);
+
+    return s;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace
 
 
 /* -------------------------------------------------------------------------- */
 
-void HttpRequest::parseMethod(const std::string& method)
+HttpRequest::Method HttpRequest::parseMethod(std::string_view method) noexcept
 {
     if (method == "GET")
-        _method = Method::GET;
+        return Method::GET;
     else if (method == "HEAD")
-        _method = Method::HEAD;
+        return Method::HEAD;
     else if (method == "POST")
-        _method = Method::POST;
-    else
-        _method = Method::UNKNOWN;
+        return Method::POST;
+
+    return Method::UNKNOWN;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-void HttpRequest::parseVersion(const std::string& ver)
+HttpRequest::Version HttpRequest::parseVersion(std::string_view ver) noexcept
 {
-    const size_t vstrlen = sizeof("HTTP/x.x") - 1;
-    std::string v = ver.size() > vstrlen ? ver.substr(0, vstrlen) : ver;
+    const std::string_view v = ver.substr(0, sizeof("HTTP/x.x") - 1);
 
     if (v == "HTTP/1.0")
-        _version = Version::HTTP_1_0;
+        return Version::HTTP_1_0;
     else if (v == "HTTP/1.1")
-        _version = Version::HTTP_1_1;
-    else
-        _version = Version::UNKNOWN;
+        return Version::HTTP_1_1;
+
+    return Version::UNKNOWN;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpRequest::parseRequestLine(std::string_view line) noexcept
+{
+    std::string_view tokens[3];
+    size_t count = 0;
+
+    // Tokens are separated by one or more spaces
+    while (!line.empty()) {
+        line = trim(line);
+
+        if (line.empty())
+            break;
+
+        if (count == 3)
+            return false;
+
+        const size_t end = std::min(CharScanner::find(line, ' '), line.size());
+
+        tokens[count++] = line.substr(0, end);
+        line.remove_prefix(end);
+    }
+
+    if (count != 3)
+        return false;
+
+    _method = parseMethod(tokens[0]);
+    _version = parseVersion(tokens[2]);
+
+    // The root is mapped on the default page
+    _uri = tokens[1] == "/"
+        ? std::string_view(HTTP_SERVER_INDEX)
+        : tokens[1];
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpRequest::parseField(
+    std::string_view name, std::string_view value) noexcept
+{
+    // No white space is allowed between name and colon, a line
+    // starting by a white space is an obsolete continuation line
+    if (name.empty() || isSpace(name.front()) || isSpace(name.back()))
+        return false;
+
+    if (_fieldCount >= HTTP_SERVER_MAX_HEADER_FIELDS)
+        return false;
+
+    Field& field = _fields[_fieldCount++];
+    field.name = name;
+    field.value = trim(value);
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpRequest::parse(std::string_view header) noexcept
+{
+    _header = header;
+    _method = Method::UNKNOWN;
+    _version = Version::UNKNOWN;
+    _uri = std::string_view();
+    _fieldCount = 0;
+
+    // Returns the text up to the end of line, without CR, and skips
+    // the line terminator
+    auto nextLine = [&header](size_t eol) {
+        eol = std::min(eol, header.size());
+
+        std::string_view line = header.substr(0, eol);
+        header.remove_prefix(std::min(eol + 1, header.size()));
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        return line;
+    };
+
+    // Empty header
+    if (header.empty())
+        return false;
+
+    bool ok = parseRequestLine(nextLine(CharScanner::find(header, '\n')));
+
+    while (ok && !header.empty()) {
+        // The colon is searched along with the end of line, so each
+        // field line is scanned once
+        const size_t colon = CharScanner::find(header, ':', '\n');
+
+        if (colon == CharScanner::npos || header[colon] == '\n') {
+            ok = false;
+            break;
+        }
+
+        std::string_view name = header.substr(0, colon);
+        header.remove_prefix(colon + 1);
+
+        ok = parseField(name, nextLine(CharScanner::find(header, '\n')));
+    }
+
+    if (!ok)
+        _method = Method::UNKNOWN;
+
+    return ok;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view HttpRequest::getField(std::string_view name) const noexcept
+{
+    auto equal = [](char a, char b) {
+        return ::tolower(uint8_t(a)) == ::tolower(uint8_t(b));
+    };
+
+    for (size_t i = 0; i < _fieldCount; ++i) {
+        const Field& field = _fields[i];
+
+        if (field.name.size() == name.size()
+            && std::equal(name.begin(), name.end(), field.name.begin(), equal))
+        {
+            return field.value;
+        }
+    }
+
+    return std::string_view();
 }
 
 
@@ -48,14 +219,12 @@ void HttpRequest::parseVersion(const std::string& ver)
 std::ostream& HttpRequest::dump(std::ostream& os, const std::string& id)
 {
     std::string ss;
-    
+
     ss = ">>> REQUEST " + id + "\n";
+    ss.append(_header.data(), _header.size());
+    ss += "\n";
 
-    for (auto e : get_header())
-        ss += e;
-    
-    os << ss << "\n";
+    Tools::writeLog(os, ss);
 
     return os;
 }
-
@@ -10,85 +10,602 @@
 /* -------------------------------------------------------------------------- */
 
 #include "HttpResponse.h"
+#include "GzipCache.h"
+#include "HttpClock.h"
+#include "HttpStats.h"
+#include "MimeTypes.h"
 #include "Tools.h"
 #include "config.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
 
 /* -------------------------------------------------------------------------- */
 
 void HttpResponse::formatError(
-    std::string& output, int code, const std::string& msg)
+    std::pmr::string& output, 
+    int code, 
+    const std::string& msg, 
+    const std::string& fields)
 {
     std::string scode = std::to_string(code);
 
     std::string error_html = "<html><head><title>" + scode + " " + msg
-        + "</title></head>" + "<body>Forbidden</body></html>\r\n";
+        + "</title></head>" + "<body>" + msg + "</body></html>\r\n";
 
     output = "HTTP/1.1 " + scode + " " + msg + "\r\n";
-    output += "Date: " + Tools::getLocalTime() + "\r\n";
+    output += "Date: " + HttpClock::getDate() + "\r\n";
     output += "Server: " HTTP_SERVER_NAME "\r\n";
     output += "Content-Length: " + std::to_string(error_html.size()) + "\r\n";
     output += "Connection: Keep-Alive\r\n";
+    output += fields;
     output += "Content-Type: text/html\r\n\r\n";
     output += error_html;
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+void HttpResponse::formatStats(bool headOnly)
+{
+    auto metrics = std::make_shared<std::string>();
+    HttpStats::getInstance().format(*metrics);
+
+    char date[HttpClock::DATE_SIZE + 1];
+    HttpClock::getDate(date);
+
+    _statusCode = 200;
+
+    _response = "HTTP/1.1 200 OK\r\n";
+    _response += "Content-Length: " + std::to_string(metrics->size()) + "\r\n";
+    _response += "Server: " HTTP_SERVER_NAME "\r\n";
+    _response += "Connection: Keep-Alive\r\n";
+    _response += "Cache-Control: no-store\r\n";
+    _response += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+    _response.append("Date: ").append(date, HttpClock::DATE_SIZE);
+    _response.append("\r\n\r\n");
+
+    _bodySize = int64_t(metrics->size());
+
+    if (!headOnly)
+        _content = metrics;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Content codings of the precompressed variants, the preferred first
+const HttpResponse::Encoding HttpResponse::_encodings[] = {
+    { "br", ".br" },   // BROTLI
+    { "gzip", ".gz" }, // GZIP
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpResponse::formatFileHeader(
+    std::string& header, 
+    const FileCache::Entry& fileEntry)
+{
+    formatFileHeader(header, fileEntry.getSize(), fileEntry.getModTime(), 
+        fileEntry.getETag(), fileEntry.getExt(), nullptr);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpResponse::formatEncodedHeader(
+    std::string& header, 
+    const FileCache::Entry& fileEntry)
+{
+    const std::string& path = fileEntry.getPath();
+
+    header.clear();
+
+    for (const Encoding& e : _encodings) {
+        if (fileEntry.getExt() != e.ext)
+            continue;
+
+        // The extension of "foo.js" for "foo.js.gz"
+        const std::string name = path.substr(0, path.size() - ::strlen(e.ext));
+        const std::string::size_type pos = name.find_last_of("./");
+
+        const std::string ext = pos != std::string::npos && name[pos] == '.'
+            ? name.substr(pos)
+            : ".";
+
+        formatFileHeader(header, fileEntry.getSize(), fileEntry.getModTime(),
+            fileEntry.getETag(), ext, e.name);
+        return;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpResponse::formatFileHeader(
+    std::string& header, 
+    int64_t size,
+    time_t modTime,
+    const std::string& etag,
+    const std::string& ext,
+    const char* encoding)
+{
+    char fileTime[HttpClock::DATE_SIZE + 1];
+    HttpClock::formatDate(modTime, fileTime);
+
+    header = "HTTP/1.1 200 OK\r\n";
+    header += "Content-Length: " + std::to_string(size) + "\r\n";
+    header += "Server: " HTTP_SERVER_NAME "\r\n";
+    header += "Connection: Keep-Alive\r\n";
+    header += "Accept-Ranges: bytes\r\n";
+    header += "Last-Modified: ";
+    header.append(fileTime, HttpClock::DATE_SIZE);
+    header += "\r\n";
+    header += "ETag: " + etag + "\r\n";
+    header += "Content-Type: ";
+
+    // Resolve mime type using the uri/file extension
+    std::string_view mimeType = MimeTypes::lookup(ext);
+
+    header.append(mimeType.data(), mimeType.size());
+
+    header += "\r\n";
+
+    if (encoding) {
+        header += "Content-Encoding: ";
+        header += encoding;
+        header += "\r\n";
+    }
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 void HttpResponse::formatPositiveResponse(
-    std::string& response, std::string& fileTime,
-    std::string& fileExt,
-    size_t& contentLen)
+    std::pmr::string& response, 
+    const std::string& header,
+    bool vary)
+{
+    static const char varyField[] = "Vary: Accept-Encoding\r\n";
+
+    char date[HttpClock::DATE_SIZE + 1];
+    HttpClock::getDate(date);
+
+    response.reserve(header.size() + sizeof(varyField)
+        + HttpClock::DATE_SIZE + sizeof("Date: \r\n\r\n"));
+
+    // Only the Date field changes from a response to another
+    response.assign(header);
+
+    if (vary)
+        response.append(varyField);
+
+    response.append("Date: ").append(date, HttpClock::DATE_SIZE);
+
+    // Close the rensponse header by using the sequence CRFL twice
+    response.append("\r\n\r\n");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpResponse::formatNotModified(
+    std::pmr::string& response, 
+    const std::string& etag,
+    bool vary)
 {
+    char date[HttpClock::DATE_SIZE + 1];
+    HttpClock::getDate(date);
 
-    response = "HTTP/1.1 200 OK\r\n";
-    response += "Date: " + Tools::getLocalTime() + "\r\n";
+    response = "HTTP/1.1 304 Not Modified\r\n";
     response += "Server: " HTTP_SERVER_NAME "\r\n";
-    response += "Content-Length: " + std::to_string(contentLen) + "\r\n";
     response += "Connection: Keep-Alive\r\n";
-    response += "Last Modified: " + fileTime + "\r\n";
-    response += "Content-Type: ";
+    response += "ETag: " + etag + "\r\n";
 
-    // Resolve mime type using the uri/file extension
-    auto it = _mimeTbl.find(fileExt);
+    if (vary)
+        response += "Vary: Accept-Encoding\r\n";
 
-    response
-        += it != _mimeTbl.end() ? it->second : "application/octet-stream";
+    response.append("Date: ").append(date, HttpClock::DATE_SIZE);
+    response.append("\r\n\r\n");
+}
 
-    // Close the rensponse header by using the sequence CRFL twice
-    response += "\r\n\r\n";
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpResponse::isNotModified(
+    const HttpRequest& request, 
+    const std::string& etag,
+    time_t modTime)
+{
+    const std::string_view ifNoneMatch = request.getField("If-None-Match");
+
+    // If-Modified-Since is ignored when If-None-Match is present
+    if (!ifNoneMatch.empty()) {
+        if (ifNoneMatch == "*")
+            return true;
+
+        // Weak comparison: the W/ prefix is not significant
+        auto opaqueTag = [](std::string_view tag) {
+            if (tag.substr(0, 2) == "W/")
+                tag.remove_prefix(2);
+
+            return tag;
+        };
+
+        const std::string_view tag = opaqueTag(etag);
+
+        std::string_view::size_type begin = 0;
+
+        while (begin < ifNoneMatch.size()) {
+            std::string_view::size_type end = ifNoneMatch.find(',', begin);
+
+            if (end == std::string_view::npos)
+                end = ifNoneMatch.size();
+
+            std::string_view::size_type first = begin;
+            std::string_view::size_type last = end;
+
+            while (first < last && ifNoneMatch[first] == ' ')
+                ++first;
+
+            while (last > first && ifNoneMatch[last - 1] == ' ')
+                --last;
+
+            if (opaqueTag(ifNoneMatch.substr(first, last - first)) == tag)
+                return true;
+
+            begin = end + 1;
+        }
+
+        return false;
+    }
+
+    time_t since = 0;
+
+    return HttpClock::parseDate(request.getField("If-Modified-Since"), since)
+        && modTime <= since;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpResponse::formatPartialResponse(
+    std::pmr::string& response, 
+    const std::string& header,
+    int64_t size,
+    int64_t first,
+    int64_t last,
+    bool vary)
+{
+    // Skip the status line and the Content-Length field
+    std::string::size_type pos = header.find("\r\n");
+    pos = header.find("\r\n", pos + 2) + 2;
+
+    char date[HttpClock::DATE_SIZE + 1];
+    HttpClock::getDate(date);
+
+    response = "HTTP/1.1 206 Partial Content\r\n";
+    response += "Content-Length: " + std::to_string(last - first + 1) + "\r\n";
+    response += "Content-Range: bytes " + std::to_string(first) + "-"
+        + std::to_string(last) + "/" + std::to_string(size)
+        + "\r\n";
+    response.append(header, pos, std::string::npos);
+
+    if (vary)
+        response += "Vary: Accept-Encoding\r\n";
+
+    response.append("Date: ").append(date, HttpClock::DATE_SIZE);
+    response.append("\r\n\r\n");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int HttpResponse::parseRange(
+    std::string_view field, 
+    int64_t size, 
+    int64_t& first, 
+    int64_t& last)
+{
+    const char unit[] = "bytes=";
+    const size_t unitLen = sizeof(unit) - 1;
+
+    if (field.substr(0, unitLen) != unit
+        || field.find(',') != std::string_view::npos)
+    {
+        return 200;
+    }
+
+    // Parses a decimal number, returns -1 if there are no digits,
+    // and stops before overflowing
+    auto parseNumber = [&field](std::string_view::size_type& pos) -> int64_t {
+        const std::string_view::size_type begin = pos;
+        int64_t value = 0;
+
+        while (pos < field.size() && ::isdigit(uint8_t(field[pos]))) {
+            if (value > (INT64_MAX - 9) / 10)
+                return -1;
+
+            value = value * 10 + (field[pos++] - '0');
+        }
+
+        return pos > begin ? value : -1;
+    };
+
+    std::string::size_type pos = unitLen;
+
+    int64_t begin = parseNumber(pos);
+
+    if (pos >= field.size() || field[pos++] != '-')
+        return 200;
+
+    int64_t end = parseNumber(pos);
+
+    if (pos != field.size() || (begin < 0 && end < 0))
+        return 200;
+
+    if (begin < 0) {
+        // Suffix range: the last bytes of the file
+        if (end == 0 || size == 0)
+            return 416;
+
+        first = end < size ? size - end : 0;
+        last = size - 1;
+        return 206;
+    }
+
+    if (end >= 0 && end < begin)
+        return 200;
+
+    if (begin >= size)
+        return 416;
+
+    first = begin;
+    last = end < 0 || end >= size ? size - 1 : end;
+
+    return 206;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpResponse::isAccepted(std::string_view field, const char* coding)
+{
+    // Content-codings and their parameters are case-insensitive
+    auto equal = [](char a, char b) {
+        return ::tolower(uint8_t(a)) == ::tolower(uint8_t(b));
+    };
+
+    const std::string_view name(coding);
+
+    // Quality of the coding if listed, otherwise of "*" if listed
+    double quality = -1;
+    double anyQuality = -1;
+
+    std::string_view::size_type begin = 0;
+
+    while (begin < field.size()) {
+        std::string_view::size_type end = field.find(',', begin);
+
+        if (end == std::string_view::npos)
+            end = field.size();
+
+        std::string_view item = field.substr(begin, end - begin);
+        begin = end + 1;
+
+        double q = 1;
+        std::string_view::size_type pos = item.find(';');
+
+        if (pos != std::string_view::npos) {
+            std::string_view::size_type qpos = std::search(
+                item.begin() + pos, item.end(), "q=", "q=" + 2, equal)
+                - item.begin();
+
+            if (qpos != item.size()) {
+                // The value is copied, as it is not null-terminated
+                char value[8] = { 0 };
+                item.copy(value, sizeof(value) - 1, qpos + 2);
+                q = ::atof(value);
+            }
+
+            item = item.substr(0, pos);
+        }
+
+        pos = item.find_first_not_of(" \t");
+        item.remove_prefix(std::min(pos, item.size()));
+        item = item.substr(0, item.find_last_not_of(" \t") + 1);
+
+        if (item.size() == name.size()
+            && std::equal(name.begin(), name.end(), item.begin(), equal))
+        {
+            quality = q;
+        }
+        else if (item == "*")
+            anyQuality = q;
+    }
+
+    return (quality >= 0 ? quality : anyQuality) > 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+FileCache::Entry::Handle HttpResponse::findEncodedVariant(
+    std::string_view acceptEncoding,
+    const std::pmr::string& localPath,
+    const Encoding*& encoding,
+    bool& hasVariants)
+{
+    std::pmr::string path(localPath.get_allocator());
+    FileCache::Entry::Handle found;
+
+    for (const Encoding& e : _encodings) {
+        path.assign(localPath).append(e.ext);
+
+        // Variants are probed on every request, so their absence
+        // is cached as well
+        FileCache::Entry::Handle variant = 
+            FileCache::getInstance().get(path, true);
+
+        if (!variant)
+            continue;
+
+        // Even a variant not accepted makes the response depend on
+        // Accept-Encoding, as far as shared caches are concerned
+        hasVariants = true;
+
+        if (!found && isAccepted(acceptEncoding, e.name)) {
+            encoding = &e;
+            found = std::move(variant);
+        }
+    }
+
+    return found;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 HttpResponse::HttpResponse(
-    const HttpRequest& request, const std::string& webRootPath)
+    const HttpRequest& request, 
+    const std::string& webRootPath,
+    Arena& arena)
+    : _response(&arena)
+    , _localUriPath(&arena)
 {
     if (request.getMethod() == HttpRequest::Method::UNKNOWN) {
-        formatError(_response, 403, "Forbidden");
+        _statusCode = 403;
+        formatError(_response, _statusCode, "Forbidden");
         return;
     }
 
-    auto rpath = [](std::string& s) {
-        if (!s.empty() && s[0] != '/')
-            s = "/" + s;
-    };
+    const bool isGetOrHead = 
+        request.getMethod() == HttpRequest::Method::GET
+        || request.getMethod() == HttpRequest::Method::HEAD;
+
+    const std::string_view uri = request.getUri();
+
+    // The metrics are not a file of the web root
+    if (isGetOrHead && HttpStats::getInstance().isStatsUri(uri)) {
+        formatStats(request.getMethod() == HttpRequest::Method::HEAD);
+        return;
+    }
+
+    _localUriPath.reserve(webRootPath.size() + uri.size() + 1);
+    _localUriPath.assign(webRootPath);
+
+    if (!uri.empty() && uri[0] != '/')
+        _localUriPath += '/';
+
+    _localUriPath += uri;
+
+    _fileEntry = FileCache::getInstance().get(_localUriPath);
 
-    _localUriPath = request.getUri();
-    rpath(_localUriPath);
-    _localUriPath = webRootPath + _localUriPath;
+    const std::string_view acceptEncoding = 
+        isGetOrHead ? request.getField("Accept-Encoding") : std::string_view();
 
-    std::string fileTime, fileExt;
-    size_t contentLen = 0;
+    // A precompressed variant of the file (e.g. "foo.js.gz"), if any
+    // and accepted, replaces it, while keeping its Content-Type
+    const Encoding* encoding = nullptr;
+    bool vary = false;
 
-    if (Tools::fileStat(_localUriPath, fileTime, fileExt, contentLen)) {
-        formatPositiveResponse(_response, fileTime, fileExt, contentLen);
-    } 
-    else {
-        formatError(_response, 404, "Not Found");
+    if (_fileEntry && isGetOrHead) {
+        FileCache::Entry::Handle variant = 
+            findEncodedVariant(acceptEncoding, _localUriPath, encoding, vary);
+
+        if (variant)
+            _fileEntry = variant;
+    }
+
+    if (!_fileEntry) {
+        _statusCode = 404;
+        formatError(_response, _statusCode, "Not Found");
+        return;
+    }
+
+    // The representation which is going to be sent
+    const std::string* header = encoding 
+        ? &_fileEntry->getEncodedHeader() 
+        : &_fileEntry->getHeader();
+    const std::string* etag = &_fileEntry->getETag();
+    int64_t size = _fileEntry->getSize();
+
+#ifdef HTTP_SERVER_ZLIB_SUPPORT
+    // Otherwise a text file can be compressed on the fly: the
+    // compressed copy is available from a later request on. The
+    // response depends on Accept-Encoding even before the copy is
+    // ready, or when it is not accepted
+    GzipCache::Handle gzipVariant;
+
+    if (!encoding && isGetOrHead && GzipCache::isCompressible(*_fileEntry)) {
+        vary = true;
+
+        if (isAccepted(acceptEncoding, "gzip"))
+            gzipVariant = GzipCache::getInstance().get(_fileEntry);
     }
+
+    if (gzipVariant) {
+        encoding = &_encodings[GZIP];
+        header = &gzipVariant->header;
+        etag = &gzipVariant->etag;
+        size = int64_t(gzipVariant->content->size());
+    }
+#endif
+
+    // Validators are evaluated before the range: the client
+    // cache is up to date, so no body has to be sent at all
+    if (isGetOrHead 
+        && isNotModified(request, *etag, _fileEntry->getModTime())) 
+    {
+        _statusCode = 304;
+        formatNotModified(_response, *etag, vary);
+        return;
+    }
+
+    // Range only applies to GET (and HEAD, which mirrors it)
+    const std::string_view range = 
+        isGetOrHead ? request.getField("Range") : std::string_view();
+
+    int64_t first = 0;
+    int64_t last = size - 1;
+
+    _statusCode = range.empty() 
+        ? 200 
+        : parseRange(range, size, first, last);
+
+    if (_statusCode == 416) {
+        formatError(_response, _statusCode, "Range Not Satisfiable", 
+            "Content-Range: bytes */" + std::to_string(size) + "\r\n");
+        return;
+    }
+
+    if (_statusCode == 206)
+        formatPartialResponse(_response, *header, size, first, last, vary);
+    else
+        formatPositiveResponse(_response, *header, vary);
+
+    _bodyOffset = first;
+    _bodySize = last - first + 1;
+
+    if (request.getMethod() == HttpRequest::Method::HEAD)
+        return;
+
+#ifdef HTTP_SERVER_ZLIB_SUPPORT
+    if (gzipVariant) {
+        _content = gzipVariant->content;
+        return;
+    }
+#endif
+
+    // Small files are served from memory
+    _content = ContentCache::getInstance().get(*_fileEntry);
+    _fileBody = !_content && _bodySize > 0;
 }
 
 
@@ -99,279 +616,9 @@ std::ostream& HttpResponse::dump(std::ostream& os, const std::string& id)
     std::string ss;
     ss = "<<< RESPONSE " + id + "\n";
     ss += _response;
-    os << ss << "\n";
+    ss += "\n";
+
+    Tools::writeLog(os, ss);
 
     return os;
 }
-
-
-/* -------------------------------------------------------------------------- */
-
-std::map<std::string, std::string> HttpResponse::_mimeTbl = {
-    { ".3dm", "x-world/x-3dmf" }, { ".3dmf", "x-world/x-3dmf" },
-    { ".a", "application/octet-stream" },
-    { ".aab", "application/x-authorware-bin" },
-    { ".aam", "application/x-authorware-map" },
-    { ".aas", "application/x-authorware-seg" }, { ".abc", "text/vnd.abc" },
-    { ".acgi", "text/html" }, { ".afl", "video/animaflex" },
-    { ".ai", "application/postscript" }, { ".aif", "audio/aiff" },
-    { ".aifc", "audio/aiff" }, { ".aiff", "audio/aiff" },
-    { ".aim", "application/x-aim" }, { ".aip", "text/x-audiosoft-intra" },
-    { ".ani", "application/x-navi-animation" },
-    { ".aos", "application/x-nokia-9000-communicator-add-on-software" },
-    { ".aps", "application/mime" }, { ".arc", "application/octet-stream" },
-    { ".arj", "application/arj" }, { ".art", "image/x-jg" },
-    { ".asf", "video/x-ms-asf" }, { ".asm", "text/x-asm" },
-    { ".asp", "text/asp" }, { ".asx", "application/x-mplayer2" },
-    { ".au", "audio/basic" }, { ".avi", "video/avi" },
-    { ".avs", "video/avs-video" }, { ".bcpio", "application/x-bcpio" },
-    { ".bin", "application/octet-stream" }, { ".bm", "image/bmp" },
-    { ".bmp", "image/bmp" }, { ".boo", "application/book" },
-    { ".book", "application/book" }, { ".boz", "application/x-bzip2" },
-    { ".bsh", "application/x-bsh" }, { ".bz", "application/x-bzip" },
-    { ".bz2", "application/x-bzip2" }, { ".c", "text/plain" },
-    { ".c++", "text/plain" }, { ".cat", "application/vnd.ms-pki.seccat" },
-    { ".cc", "text/x-c" }, { ".ccad", "application/clariscad" },
-    { ".cco", "application/x-cocoa" }, { ".cdf", "application/cdf" },
-    { ".cer", "application/pkix-cert" }, { ".cha", "application/x-chat" },
-    { ".chat", "application/x-chat" }, { ".class", "application/java" },
-    { ".com", "application/octet-stream" }, { ".com", "text/plain" },
-    { ".conf", "text/plain" }, { ".cpio", "application/x-cpio" },
-    { ".cpp", "text/x-c" }, { ".cpt", "application/x-cpt" },
-    { ".crl", "application/pkcs-crl" }, { ".crt", "application/pkix-cert" },
-    { ".csh", "application/x-csh" }, { ".csh", "text/x-script.csh" },
-    { ".css", "text/css" }, { ".cxx", "text/plain" },
-    { ".dcr", "application/x-director" }, { ".deepv", "application/x-deepv" },
-    { ".def", "text/plain" }, { ".der", "application/x-x509-ca-cert" },
-    { ".dif", "video/x-dv" }, { ".dir", "application/x-director" },
-    { ".dl", "video/dl" }, { ".doc", "application/msword" },
-    { ".docx", "application/"
-               "vnd.openxmlformats-officedocument.wordprocessingml.document" },
-    { ".dot", "application/msword" }, { ".dp", "application/commonground" },
-    { ".drw", "application/drafting" }, { ".dump", "application/octet-stream" },
-    { ".dv", "video/x-dv" }, { ".dvi", "application/x-dvi" },
-    { ".dwf", "drawing/x-dwf (old)" }, { ".dwf", "model/vnd.dwf" },
-    { ".dwg", "application/acad" }, { ".dxf", "application/dxf" },
-    { ".dxr", "application/x-director" }, { ".el", "text/x-script.elisp" },
-    { ".elc", "application/x-elc" }, { ".env", "application/x-envoy" },
-    { ".eps", "application/postscript" }, { ".es", "application/x-esrehber" },
-    { ".etx", "text/x-setext" }, { ".evy", "application/envoy" },
-    { ".exe", "application/octet-stream" }, { ".f", "text/x-fortran" },
-    { ".f77", "text/x-fortran" }, { ".f90", "text/x-fortran" },
-    { ".fdf", "application/vnd.fdf" }, { ".fif", "image/fif" },
-    { ".fli", "video/fli" }, { ".flo", "image/florian" },
-    { ".flx", "text/vnd.fmi.flexstor" }, { ".fmf", "video/x-atomic3d-feature" },
-    { ".for", "text/x-fortran" }, { ".fpx", "image/vnd.fpx" },
-    { ".frl", "application/freeloader" }, { ".funk", "audio/make" },
-    { ".g", "text/plain" }, { ".g3", "image/g3fax" }, { ".gif", "image/gif" },
-    { ".gl", "video/gl" }, { ".gsd", "audio/x-gsm" }, { ".gsm", "audio/x-gsm" },
-    { ".gsp", "application/x-gsp" }, { ".gss", "application/x-gss" },
-    { ".gtar", "application/x-gtar" }, { ".gz", "application/x-compressed" },
-    { ".gz", "application/x-gzip" }, { ".gzip", "application/x-gzip" },
-    { ".h", "text/x-h" }, { ".hdf", "application/x-hdf" },
-    { ".help", "application/x-helpfile" },
-    { ".hgl", "application/vnd.hp-hpgl" }, { ".hh", "text/x-h" },
-    { ".hlb", "text/x-script" }, { ".hlp", "application/hlp" },
-    { ".hpg", "application/vnd.hp-hpgl" },
-    { ".hpgl", "application/vnd.hp-hpgl" }, { ".hqx", "application/binhex" },
-    { ".hqx", "application/binhex4" }, { ".hta", "application/hta" },
-    { ".htc", "text/x-component" }, { ".htm", "text/html" },
-    { ".html", "text/html" }, { ".htmls", "text/html" },
-    { ".htt", "text/webviewhtml" }, { ".htx", "text/html" },
-    { ".ice", "x-conference/x-cooltalk" }, { ".ico", "image/x-icon" },
-    { ".idc", "text/plain" }, { ".ief", "image/ief" }, { ".iefs", "image/ief" },
-    { ".iges", "application/iges" }, { ".iges", "model/iges" },
-    { ".igs", "application/iges" }, { ".igs", "model/iges" },
-    { ".ima", "application/x-ima" }, { ".imap", "application/x-httpd-imap" },
-    { ".inf", "application/inf" }, { ".ins", "application/x-internett-signup" },
-    { ".ip", "application/x-ip2" }, { ".isu", "video/x-isvideo" },
-    { ".it", "audio/it" }, { ".iv", "application/x-inventor" },
-    { ".ivr", "i-world/i-vrml" }, { ".ivy", "application/x-livescreen" },
-    { ".jam", "audio/x-jam" }, { ".jav", "text/x-java-source" },
-    { ".java", "text/x-java-source" },
-    { ".jcm", "application/x-java-commerce" }, { ".jfif", "image/jpeg" },
-    { ".jfif", "image/pjpeg" }, { ".jpe", "image/jpeg" },
-    { ".jpeg", "image/jpeg" }, { ".jpg", "image/jpeg" },
-    { ".jps", "image/x-jps" }, { ".js", "application/javascript" },
-    { ".jut", "image/jutvision" }, { ".kar", "audio/midi" },
-    { ".ksh", "application/x-ksh" }, { ".la", "audio/nspaudio" },
-    { ".lam", "audio/x-liveaudio" }, { ".latex", "application/x-latex" },
-    { ".lha", "application/lha" }, { ".lhx", "application/octet-stream" },
-    { ".list", "text/plain" }, { ".lma", "audio/nspaudio" },
-    { ".lma", "audio/x-nspaudio" }, { ".log", "text/plain" },
-    { ".lsp", "application/x-lisp" }, { ".lst", "text/plain" },
-    { ".lsx", "text/x-la-asf" }, { ".ltx", "application/x-latex" },
-    { ".lzh", "application/x-lzh" }, { ".lzx", "application/lzx" },
-    { ".m", "text/x-m" }, { ".m1v", "video/mpeg" }, { ".m2a", "audio/mpeg" },
-    { ".m2v", "video/mpeg" }, { ".m3u", "audio/x-mpequrl" },
-    { ".man", "application/x-troff-man" }, { ".map", "application/x-navimap" },
-    { ".mar", "text/plain" }, { ".mbd", "application/mbedlet" },
-    { ".mcd", "application/mcad" }, { ".mcf", "image/vasa" },
-    { ".mcf", "text/mcf" }, { ".mcp", "application/netmc" },
-    { ".me", "application/x-troff-me" }, { ".mht", "message/rfc822" },
-    { ".mhtml", "message/rfc822" }, { ".mid", "audio/midi" },
-    { ".midi", "audio/midi" }, { ".mif", "application/x-frame" },
-    { ".mime", "message/rfc822" },
-    { ".mjf", "audio/x-vnd.audioexplosion.mjuicemediafile" },
-    { ".mjpg", "video/x-motion-jpeg" }, { ".mm", "application/base64" },
-    { ".mme", "application/base64" }, { ".mod", "audio/mod" },
-    { ".moov", "video/quicktime" }, { ".mov", "video/quicktime" },
-    { ".movie", "video/x-sgi-movie" }, { ".mp2", "audio/mpeg" },
-    { ".mp3", "audio/mpeg3" }, { ".mpa", "audio/mpeg" },
-    { ".mpc", "application/x-project" }, { ".mpe", "video/mpeg" },
-    { ".mpeg", "video/mpeg" }, { ".mpg", "audio/mpeg" },
-    { ".mpga", "audio/mpeg" }, { ".mpp", "application/vnd.ms-project" },
-    { ".mpt", "application/x-project" }, { ".mpv", "application/x-project" },
-    { ".mpx", "application/x-project" }, { ".mrc", "application/marc" },
-    { ".ms", "application/x-troff-ms" }, { ".mv", "video/x-sgi-movie" },
-    { ".my", "audio/make" }, { ".mzz", "application/x-vnd.audioexplosion.mzz" },
-    { ".nap", "image/naplps" }, { ".naplps", "image/naplps" },
-    { ".nc", "application/x-netcdf" },
-    { ".ncm", "application/vnd.nokia.configuration-message" },
-    { ".nif", "image/x-niff" }, { ".niff", "image/x-niff" },
-    { ".nix", "application/x-mix-transfer" },
-    { ".nsc", "application/x-conference" }, { ".nvd", "application/x-navidoc" },
-    { ".o", "application/octet-stream" }, { ".oda", "application/oda" },
-    { ".omc", "application/x-omc" }, { ".omcd", "application/x-omcdatamaker" },
-    { ".omcr", "application/x-omcregerator" }, { ".p", "text/x-pascal" },
-    { ".p10", "application/pkcs10" }, { ".p12", "application/pkcs-12" },
-    { ".p7a", "application/x-pkcs7-signature" },
-    { ".p7c", "application/pkcs7-mime" },
-    { ".p7c", "application/x-pkcs7-mime" },
-    { ".p7m", "application/pkcs7-mime" },
-    { ".p7r", "application/x-pkcs7-certreqresp" },
-    { ".p7s", "application/pkcs7-signature" },
-    { ".part", "application/pro_eng" }, { ".pas", "text/pascal" },
-    { ".pbm", "image/x-portable-bitmap" }, { ".pcl", "application/vnd.hp-pcl" },
-    { ".pct", "image/x-pict" }, { ".pcx", "image/x-pcx" },
-    { ".pdb", "chemical/x-pdb" }, { ".pdf", "application/pdf" },
-    { ".pfunk", "audio/make" }, { ".pgm", "image/x-portable-graymap" },
-    { ".pic", "image/pict" }, { ".pict", "image/pict" },
-    { ".pkg", "application/x-newton-compatible-pkg" },
-    { ".pko", "application/vnd.ms-pki.pko" }, { ".pl", "text/x-script.perl" },
-    { ".plx", "application/x-pixclscript" },
-    { ".pm", "text/x-script.perl-module" },
-    { ".pm4", "application/x-pagemaker" },
-    { ".pm5", "application/x-pagemaker" }, { ".png", "image/png" },
-    { ".pnm", "application/x-portable-anymap" },
-    { ".pnm", "image/x-portable-anymap" },
-    { ".pot", "application/vnd.ms-powerpoint" },
-    { ".pot", "application/vnd.ms-powerpoint" }, { ".pov", "model/x-pov" },
-    { ".ppa", "application/vnd.ms-powerpoint" },
-    { ".ppm", "image/x-portable-pixmap" },
-    { ".pps", "application/vnd.ms-powerpoint" },
-    { ".ppt", "application/vnd.ms-powerpoint" },
-    { ".ppz", "application/vnd.ms-powerpoint" },
-    { ".pre", "application/x-freelance" }, { ".prt", "application/pro_eng" },
-    { ".ps", "application/postscript" }, { ".psd", "application/octet-stream" },
-    { ".pvu", "paleovu/x-pv" }, { ".pwz", "application/vnd.ms-powerpoint" },
-    { ".py", "text/x-script.phyton" },
-    { ".pyc", "applicaiton/x-bytecode.python" }, { ".qcp", "audio/vnd.qcelp" },
-    { ".qd3", "x-world/x-3dmf" }, { ".qd3d", "x-world/x-3dmf" },
-    { ".qif", "image/x-quicktime" }, { ".qt", "video/quicktime" },
-    { ".qtc", "video/x-qtc" }, { ".qti", "image/x-quicktime" },
-    { ".qtif", "image/x-quicktime" }, { ".ra", "audio/x-pn-realaudio" },
-    { ".ram", "audio/x-pn-realaudio" }, { ".ras", "image/cmu-raster" },
-    { ".rast", "image/cmu-raster" }, { ".rexx", "text/x-script.rexx" },
-    { ".rf", "image/vnd.rn-realflash" }, { ".rgb", "image/x-rgb" },
-    { ".rm", "audio/x-pn-realaudio" }, { ".rmi", "audio/mid" },
-    { ".rmm", "audio/x-pn-realaudio" }, { ".rmp", "audio/x-pn-realaudio" },
-    { ".rng", "application/ringing-tones" },
-    { ".rnx", "application/vnd.rn-realplayer" },
-    { ".roff", "application/x-troff" }, { ".rp", "image/vnd.rn-realpix" },
-    { ".rpm", "audio/x-pn-realaudio-plugin" }, { ".rt", "text/richtext" },
-    { ".rtf", "application/rtf" }, { ".rtx", "application/rtf" },
-    { ".rtx", "text/richtext" }, { ".rv", "video/vnd.rn-realvideo" },
-    { ".s", "text/x-asm" }, { ".s3m", "audio/s3m" },
-    { ".saveme", "application/octet-stream" },
-    { ".sbk", "application/x-tbook" },
-    { ".scm", "application/x-lotusscreencam" },
-    { ".scm", "text/x-script.guile" }, { ".sdml", "text/plain" },
-    { ".sdp", "application/sdp" }, { ".sdr", "application/sounder" },
-    { ".sea", "application/sea" }, { ".set", "application/set" },
-    { ".sgm", "text/sgml" }, { ".sgml", "text/sgml" },
-    { ".sh", "application/x-sh" }, { ".shar", "application/x-shar" },
-    { ".shtml", "text/html" }, { ".sid", "audio/x-psid" },
-    { ".sit", "application/x-sit" }, { ".skd", "application/x-koan" },
-    { ".skm", "application/x-koan" }, { ".skp", "application/x-koan" },
-    { ".skt", "application/x-koan" }, { ".sl", "application/x-seelogo" },
-    { ".smi", "application/smil" }, { ".smil", "application/smil" },
-    { ".snd", "audio/basic" }, { ".snd", "audio/x-adpcm" },
-    { ".sol", "application/solids" }, { ".spc", "text/x-speech" },
-    { ".spl", "application/futuresplash" }, { ".spr", "application/x-sprite" },
-    { ".sprite", "application/x-sprite" },
-    { ".src", "application/x-wais-source" },
-    { ".ssi", "text/x-server-parsed-html" },
-    { ".ssm", "application/streamingmedia" },
-    { ".sst", "application/vnd.ms-pki.certstore" },
-    { ".step", "application/step" }, { ".stl", "application/sla" },
-    { ".stp", "application/step" }, { ".sv4cpio", "application/x-sv4cpio" },
-    { ".sv4crc", "application/x-sv4crc" }, { ".svf", "image/vnd.dwg" },
-    { ".svr", "application/x-world" },
-    { ".swf", "application/x-shockwave-flash" },
-    { ".t", "application/x-troff" }, { ".talk", "text/x-speech" },
-    { ".tar", "application/x-tar" }, { ".tbk", "application/toolbook" },
-    { ".tcl", "application/x-tcl" }, { ".tcsh", "text/x-script.tcsh" },
-    { ".tex", "application/x-tex" }, { ".texi", "application/x-texinfo" },
-    { ".texinfo", "application/x-texinfo" }, { ".text", "text/plain" },
-    { ".tgz", "application/x-compressed" }, { ".tif", "image/tiff" },
-    { ".tiff", "image/x-tiff" }, { ".tr", "application/x-troff" },
-    { ".tsi", "audio/tsp-audio" }, { ".tsp", "audio/tsplayer" },
-    { ".tsv", "text/tab-separated-values" }, { ".turbot", "image/florian" },
-    { ".txt", "text/plain" }, { ".uil", "text/x-uil" },
-    { ".uni", "text/uri-list" }, { ".unis", "text/uri-list" },
-    { ".unv", "application/i-deas" }, { ".uri", "text/uri-list" },
-    { ".uris", "text/uri-list" }, { ".ustar", "application/x-ustar" },
-    { ".uu", "text/x-uuencode" }, { ".uue", "text/x-uuencode" },
-    { ".vcd", "application/x-cdlink" }, { ".vcs", "text/x-vcalendar" },
-    { ".vda", "application/vda" }, { ".vdo", "video/vdo" },
-    { ".vew", "application/groupwise" }, { ".viv", "video/vivo" },
-    { ".viv", "video/vnd.vivo" }, { ".vivo", "video/vivo" },
-    { ".vmd", "application/vocaltec-media-desc" },
-    { ".vmf", "application/vocaltec-media-file" }, { ".voc", "audio/voc" },
-    { ".vos", "video/vosaic" }, { ".vox", "audio/voxware" },
-    { ".vqe", "audio/x-twinvq-plugin" }, { ".vqf", "audio/x-twinvq" },
-    { ".vql", "audio/x-twinvq-plugin" }, { ".vrml", "model/vrml" },
-    { ".vrt", "x-world/x-vrt" }, { ".vsd", "application/x-visio" },
-    { ".vst", "application/x-visio" }, { ".vsw", "application/x-visio" },
-    { ".w60", "application/wordperfect6.0" },
-    { ".w61", "application/wordperfect6.1" }, { ".w6w", "application/msword" },
-    { ".wav", "audio/wav" }, { ".wb1", "application/x-qpro" },
-    { ".wbmp", "image/vnd.wap.wbmp" }, { ".web", "application/vnd.xara" },
-    { ".wiz", "application/msword" }, { ".wk1", "application/x-123" },
-    { ".wmf", "windows/metafile" }, { ".wml", "text/vnd.wap.wml" },
-    { ".wmlc", "application/vnd.wap.wmlc" },
-    { ".wmls", "text/vnd.wap.wmlscript" },
-    { ".wmlsc", "application/vnd.wap.wmlscriptc" },
-    { ".word", "application/msword" }, { ".wp", "application/wordperfect" },
-    { ".wp5", "application/wordperfect" },
-    { ".wp5", "application/wordperfect6.0" },
-    { ".wp6", "application/wordperfect" },
-    { ".wpd", "application/wordperfect" }, { ".wpd", "application/x-wpwin" },
-    { ".wq1", "application/x-lotus" }, { ".wri", "application/mswrite" },
-    { ".wrl", "model/vrml" }, { ".wrz", "model/vrml" },
-    { ".wsc", "text/scriplet" }, { ".wsrc", "application/x-wais-source" },
-    { ".wtk", "application/x-wintalk" }, { ".xbm", "image/x-xbitmap" },
-    { ".xdr", "video/x-amt-demorun" }, { ".xgz", "xgl/drawing" },
-    { ".xif", "image/vnd.xiff" }, { ".xl", "application/vnd.ms-excel" },
-    { ".xla", "application/vnd.ms-excel" },
-    { ".xlb", "application/vnd.ms-excel" },
-    { ".xlc", "application/vnd.ms-excel" },
-    { ".xld", "application/vnd.ms-excel" },
-    { ".xlk", "application/vnd.ms-excel" },
-    { ".xll", "application/vnd.ms-excel" },
-    { ".xlm", "application/vnd.ms-excel" },
-    { ".xls", "application/vnd.ms-excel" },
-    { ".xlt", "application/vnd.ms-excel" },
-    { ".xlv", "application/vnd.ms-excel" },
-    { ".xlw", "application/vnd.ms-excel" }, { ".xm", "audio/xm" },
-    { ".xml", "application/xml" }, { ".xmz", "xgl/movie" },
-    { ".xpix", "application/x-vnd.ls-xpix" }, { ".xpm", "image/xpm" },
-    { ".xsr", "video/x-amt-showrun" }, { ".xwd", "image/x-xwd" },
-    { ".xyz", "chemical/x-pdb" }, { ".z", "application/x-compress" },
-    { ".zip", "application/zip" }, { ".zoo", "application/octet-stream" },
-    { ".zsh", "text/x-script.zsh" },
-};
-
-
-/* -------------------------------------------------------------------------- */
\ No newline at end of file
@@ -0,0 +1,126 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpResponseQueue.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpResponseQueue::push(
+    const HttpResponse& response, 
+    HttpStats::Clock::time_point received)
+{
+    _items.emplace_back();
+
+    Item& item = _items.back();
+    item.header = response;
+    item.content = response.getContent();
+    item.received = received;
+    item.fileBody = response.hasFileBody();
+
+    if (item.content) {
+        item.contentOffset = size_t(response.getBodyOffset());
+        item.contentSize = size_t(response.getBodySize());
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int HttpResponseQueue::fill(
+    TransportSocket::Buffer* buffers, int maxCount) const noexcept
+{
+    int count = 0;
+
+    // Bytes already sent are skipped
+    size_t skip = _offset;
+
+    auto add = [&](const char* data, size_t size) {
+        if (skip >= size) {
+            skip -= size;
+            return;
+        }
+
+        buffers[count].data = data + skip;
+        buffers[count].size = size - skip;
+        ++count;
+        skip = 0;
+    };
+
+    for (size_t i = _head; i < _items.size(); ++i) {
+        const Item& item = _items[i];
+
+        if (count + 2 > maxCount)
+            break;
+
+        add(item.header.data(), item.header.size());
+
+        if (item.content)
+            add(item.content->data() + item.contentOffset, item.contentSize);
+    }
+
+    return count;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpResponseQueue::consume(size_t bytes) noexcept
+{
+    HttpStats::countBytesSent(bytes);
+
+    const auto now = HttpStats::Clock::now();
+
+    // The first response may have been partially sent already,
+    // the following ones start with these bytes
+    const bool started = _offset > 0;
+
+    _offset += bytes;
+
+    for (bool first = true; !empty(); first = false) {
+        Item& item = _items[_head];
+
+        if (!_offset)
+            break;
+
+        if (!first || !started)
+            HttpStats::countFirstByte(now - item.received);
+
+        if (_offset < item.size())
+            break;
+
+        if (!item.fileBody)
+            HttpStats::countResponse(now - item.received);
+
+        _offset -= item.size();
+        item.content.reset();
+
+        if (++_head == _items.size())
+            clear();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int64_t HttpResponseQueue::send(TransportSocket& socket, int flags) noexcept
+{
+    TransportSocket::Buffer buffers[TransportSocket::MAX_SEND_BUFFERS];
+
+    int count = fill(buffers, TransportSocket::MAX_SEND_BUFFERS);
+
+    int64_t sent = socket.sendv(buffers, count, flags);
+
+    if (sent > 0)
+        consume(size_t(sent));
+
+    return sent;
+}
@@ -13,211 +13,322 @@
 /* -------------------------------------------------------------------------- */
 
 #include "HttpServer.h"
+#include "HttpDispatcher.h"
+#include "HttpReactor.h"
+#include "HttpServerTask.h"
+#include "HttpUringReactor.h"
+#include "AccessLog.h"
+#include "GzipCache.h"
+#include "HttpClock.h"
+#include "HttpStats.h"
 #include "Tools.h"
 
+#include <algorithm>
 #include <thread>
 #include <cassert>
 
+#include <errno.h>
 
-/* -------------------------------------------------------------------------- */
-// HttpServerTask
 
 /* -------------------------------------------------------------------------- */
+// HttpServer
 
-class HttpServerTask {
-private:
-    std::ostream& _logger;
-    bool _verboseModeOn = true;
-    TcpSocket::Handle _tcpSocketHandle;
-    std::string _webRootPath;
 
-    std::ostream& log() { 
-        return _logger; 
-    }
+/* -------------------------------------------------------------------------- */
 
-    bool verboseModeOn() const { 
-        return _verboseModeOn; 
+auto HttpServer::getInstance() -> HttpServer&
+{
+    if (!_instance) {
+        _instance = new HttpServer();
     }
 
-    TcpSocket::Handle& getTcpSocketHandle() {
-        return _tcpSocketHandle;
-    }
+    return *_instance;
+}
 
-    const std::string& getWebRootPath() const { 
-        return _webRootPath; 
-    }
 
-    HttpServerTask(bool verboseModeOn, std::ostream& loggerOStream,
-        TcpSocket::Handle socketHandle, const std::string& webRootPath)
-        : _verboseModeOn(verboseModeOn)
-        , _logger(loggerOStream)
-        , _tcpSocketHandle(socketHandle)
-        , _webRootPath(webRootPath)
-    {
-    }
+/* -------------------------------------------------------------------------- */
 
-public:
-    using Handle = std::shared_ptr<HttpServerTask>;
-
-    inline static Handle create(
-        bool verboseModeOn, 
-        std::ostream& loggerOStream,
-        TcpSocket::Handle socketHandle, 
-        const std::string& webRootPath)
-    {
-        return Handle(new HttpServerTask(
-            verboseModeOn, 
-            loggerOStream, 
-            socketHandle, 
-            webRootPath));
-    }
+bool HttpServer::bind(TranspPort port)
+{
+    size_t shards = _listenerShards;
 
-    HttpServerTask() = delete;
-    void operator()(Handle task_handle);
-};
+    if (!shards)
+        shards = std::max(1U, std::thread::hardware_concurrency());
 
+    _listeners.clear();
 
-/* -------------------------------------------------------------------------- */
+    for (size_t shard = 0; shard < shards; ++shard) {
+        TcpListener::Handle listener = TcpListener::create();
 
-// Handles the HTTP server request
-// This method executes in a specific thread context for
-// each accepted HTTP request
-void HttpServerTask::operator()(Handle task_handle)
-{
-    (void)task_handle;
+        if (!listener || !*listener)
+            return false;
 
-    const int sd = getTcpSocketHandle()->getSocketFd();
+        if (shards > 1 && !listener->setReusePort())
+            return false;
 
-    // Generates an identifier for recognizing the transaction
-    auto transactionId = [sd]() {
-        return "[" + std::to_string(sd) + "] " + "["
-            + Tools::getLocalTime() + "]";
-    };
+        if (!listener->bind(port))
+            return false;
 
-    if (verboseModeOn())
-        log() << transactionId() << "---- http_server_task +\n\n";
+        _listeners.push_back(std::move(listener));
+    }
 
-    while (getTcpSocketHandle()) {
-        // Create an http socket around a connected tcp socket
-        HttpSocket httpSocket(getTcpSocketHandle());
+    std::vector<const TcpListener*> listeners;
 
-        // Wait for a request from remote peer
-        HttpRequest::Handle httpRequest;
-        httpSocket >> httpRequest;
+    for (const auto& listener : _listeners)
+        listeners.push_back(listener.get());
 
-        // If an error occoured terminate the task
-        if (!httpSocket)
-            break;
+    HttpStats::getInstance().setListeners(std::move(listeners));
 
-        // Log the request
-        if (verboseModeOn())
-            httpRequest->dump(log(), transactionId());
+    _serverPort = port;
 
-        // Build a response to previous HTTP request
-        HttpResponse response(*httpRequest, getWebRootPath());
+    return true;
+}
 
-        // Send the response to remote peer
-        httpSocket << response;
 
-        // If HTTP command line method isn't HEAD then send requested URI
-        if (httpRequest->getMethod() != HttpRequest::Method::HEAD) {
-            if (0 > httpSocket.sendFile(response.getLocalUriPath())) {
-                if (verboseModeOn())
-                    log() << transactionId() << "Error sending '"
-                          << response.getLocalUriPath() << "'\n\n";
-                break;
-            }
-        }
+/* -------------------------------------------------------------------------- */
 
-        if (verboseModeOn())
-            response.dump(log(), transactionId());
+bool HttpServer::listen(int maxConnections)
+{
+    if (_listeners.empty()) {
+        return false;
     }
 
-    getTcpSocketHandle()->shutdown();
-
-    if (verboseModeOn()) {
-        log() << transactionId() << "---- http_server_task -\n\n";
-        log().flush();
+    for (auto& listener : _listeners) {
+        if (!listener->listen(maxConnections))
+            return false;
     }
+
+    return true;
 }
 
 
 /* -------------------------------------------------------------------------- */
-// HttpServer
+
+bool HttpServer::run()
+{
+    if (_listeners.empty()) {
+        return false;
+    }
+
+    return _reactorModeOn ? runReactor() : runThreads();
+}
 
 
 /* -------------------------------------------------------------------------- */
 
-auto HttpServer::getInstance() -> HttpServer&
+template <class Reactor>
+bool HttpServer::runReactors()
 {
-    if (!_instance) {
-        _instance = new HttpServer();
+    assert(_loggerOStreamPtr);
+
+    std::vector<std::unique_ptr<Reactor>> reactors;
+
+    for (auto& listener : _listeners) {
+        reactors.emplace_back(new Reactor(
+            *listener, 
+            getWebRootPath(), 
+            _verboseModeOn, 
+            *_loggerOStreamPtr,
+            _timeouts));
+
+        if (!reactors.back()->open())
+            return false;
     }
 
-    return *_instance;
+    // Each listener has its own event loop, 
+    // the first one runs in the caller thread
+    std::vector<std::thread> threads;
+
+    for (size_t shard = 1; shard < reactors.size(); ++shard)
+        threads.emplace_back([&reactors, shard]() { reactors[shard]->run(); });
+
+    bool res = reactors[0]->run();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return res;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-bool HttpServer::bind(TranspPort port)
+bool HttpServer::runReactor()
 {
-    _tcpServer = TcpListener::create();
+#ifdef HTTP_SERVER_IO_URING_SUPPORT
+    if (_ioUringOn)
+        return runReactors<HttpUringReactor>();
+#endif
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+    return runReactors<HttpReactor>();
+#else
+    return false;
+#endif
+}
 
-    if (!_tcpServer) {
-        return false;
-    }
 
-    return _tcpServer->bind(port);
+/* -------------------------------------------------------------------------- */
+
+bool HttpServer::setupIoUring(bool on)
+{
+#ifdef HTTP_SERVER_IO_URING_SUPPORT
+    _ioUringOn = on && HttpUringReactor::isSupported();
+    return _ioUringOn == on;
+#else
+    return !on;
+#endif
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-bool HttpServer::listen(int maxConnections)
+bool HttpServer::setupGzipCache(size_t budget)
 {
-    if (!_tcpServer) {
-        return false;
+#ifdef HTTP_SERVER_ZLIB_SUPPORT
+    GzipCache::getInstance().setup(budget);
+    return true;
+#else
+    return !budget;
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+bool HttpServer::runThreads()
+{
+    assert(_loggerOStreamPtr);
+
+    // The pool is destroyed first, as its workers hand the connections
+    // back to the dispatchers
+    std::vector<std::unique_ptr<HttpDispatcher>> dispatchers;
+    ThreadPool::Handle threadPool = ThreadPool::create(_threadPoolSize);
+
+    for (auto& listener : _listeners) {
+        dispatchers.emplace_back(new HttpDispatcher(
+            *listener,
+            *threadPool,
+            getWebRootPath(),
+            _verboseModeOn,
+            *_loggerOStreamPtr,
+            _timeouts));
+
+        if (!dispatchers.back()->open())
+            return false;
+    }
+
+    // Each listener has its own dispatcher, 
+    // the first one runs in the caller thread
+    std::vector<std::thread> acceptors;
+
+    for (size_t shard = 1; shard < dispatchers.size(); ++shard) {
+        acceptors.emplace_back(
+            [&dispatchers, shard]() { dispatchers[shard]->run(); });
     }
 
-    return _tcpServer->listen(maxConnections);
+    bool res = dispatchers[0]->run();
+
+    for (auto& acceptor : acceptors)
+        acceptor.join();
+
+    return res;
 }
 
+#else
 
 /* -------------------------------------------------------------------------- */
 
-bool HttpServer::run()
+void HttpServer::acceptConnections(size_t shard, ThreadPool& threadPool)
 {
-    // Create a thread for each TCP accepted connection and
-    // delegate it to handle HTTP request / response
+    TcpListener& listener = *_listeners[shard];
+
+    // The listener is polled for readiness, then all the pending
+    // connections are accepted without blocking
+    if (!listener.setNonBlockingMode())
+        return;
+
+    assert(_loggerOStreamPtr);
+
     while (true) {
-        const TcpSocket::Handle handle = accept();
+        auto recvEv = listener.waitForRecvEvent(std::chrono::seconds(1));
+
+        if (recvEv == TransportSocket::RecvEvent::TIMEOUT)
+            continue;
 
-        // Fatal error: we stop the server
-        if (!handle) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (recvEv == TransportSocket::RecvEvent::RECV_ERROR) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(HTTP_SERVER_ACCEPT_BACKOFF));
             continue;
         }
 
-        assert(_loggerOStreamPtr);
+        while (true) {
+            const TcpSocket::Handle handle = accept(shard);
 
-        HttpServerTask::Handle taskHandle = HttpServerTask::create(
-            _verboseModeOn, 
-            *_loggerOStreamPtr, 
-            handle, 
-            getWebRootPath());
+            if (!handle) {
+                // Queue drained
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+
+                HttpStats::countAcceptError();
+
+                if (errno == ECONNABORTED)
+                    continue;
+
+                // Resources exhausted: retry shortly
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(HTTP_SERVER_ACCEPT_BACKOFF));
+                break;
+            }
 
-        // Coping the http_server_task handle (shared_ptr) the reference
-        // count is automatically increased by one
-        std::thread workerThread(*taskHandle, taskHandle);
+            // Without a readiness notification facility the connections
+            // cannot be monitored by the acceptor, so a task is submitted
+            // to the worker thread pool for each TCP accepted connection,
+            // serving it until closed
+            HttpServerTask::Handle taskHandle = HttpServerTask::create(
+                _verboseModeOn, 
+                *_loggerOStreamPtr, 
+                handle, 
+                getWebRootPath(),
+                _timeouts);
+
+            // Coping the http_server_task handle (shared_ptr) the 
+            // reference count is automatically increased by one
+            threadPool.submit([taskHandle]() { (*taskHandle)(); });
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
 
-        workerThread.detach();
+bool HttpServer::runThreads()
+{
+    ThreadPool::Handle threadPool = ThreadPool::create(_threadPoolSize);
+
+    // Each listener has its own accept loop, 
+    // the first one runs in the caller thread
+    std::vector<std::thread> acceptors;
+
+    for (size_t shard = 1; shard < _listeners.size(); ++shard) {
+        acceptors.emplace_back([this, shard, &threadPool]() {
+            acceptConnections(shard, *threadPool);
+        });
     }
 
+    acceptConnections(0, *threadPool);
+
     // Ok, following instruction won't be ever executed
+    for (auto& acceptor : acceptors)
+        acceptor.join();
+
     return true;
 }
 
+#endif // HTTP_SERVER_EPOLL_SUPPORT
+
 
 /* -------------------------------------------------------------------------- */
 
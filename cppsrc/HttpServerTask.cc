@@ -0,0 +1,164 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpServerTask.h"
+#include "AccessLog.h"
+#include "HttpClock.h"
+#include "Tools.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpServerTask::HttpServerTask(
+    bool verboseModeOn,
+    std::ostream& logger,
+    TcpSocket::Handle socketHandle,
+    const std::string& webRootPath,
+    const HttpTimeouts& timeouts)
+    : _verboseModeOn(verboseModeOn)
+    , _logger(logger)
+    , _socketHandle(socketHandle)
+    , _httpSocket(socketHandle)
+    , _webRootPath(webRootPath)
+    , _timeouts(timeouts)
+{
+    _socketHandle->setSendTimeout(_timeouts.send);
+
+    if (_verboseModeOn)
+        Tools::writeLog(
+            _logger, transactionId() + "---- http_server_task +\n\n");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Generates an identifier for recognizing the transaction
+std::string HttpServerTask::transactionId() const
+{
+    return "[" + std::to_string(getSocketFd()) + "] " + "["
+        + HttpClock::getDate() + "]";
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpServerTask::serve()
+{
+    _stats.setIdle(false);
+
+    while (_httpSocket && _httpSocket.hasPendingRequest()) {
+        // The request has been already received, so it is parsed
+        // without waiting
+        HttpRequest httpRequest;
+        _httpSocket >> httpRequest;
+
+        // If an error occoured terminate the task
+        if (!_httpSocket)
+            break;
+
+        ++_requestCount;
+
+        // Log the request
+        if (_verboseModeOn)
+            httpRequest.dump(_logger, transactionId());
+
+        // Build a response to previous HTTP request
+        HttpResponse response(
+            httpRequest, _webRootPath, _httpSocket.getArena());
+
+        HttpStats::countRequest(
+            httpRequest.getMethod(), response.getStatusCode());
+        AccessLog::write(*_socketHandle, httpRequest, response);
+
+        // Send the response to remote peer
+        _httpSocket << response;
+
+        // If HTTP command line method isn't HEAD then send requested URI
+        // unless the body has been already sent from memory
+        if (response.hasFileBody() && 0 > _httpSocket.sendFile(response)) {
+            if (_verboseModeOn)
+                Tools::writeLog(_logger, transactionId() + "Error sending '"
+                    + std::string(response.getLocalUriPath()) + "'\n\n");
+
+            close();
+            return false;
+        }
+
+        if (_verboseModeOn)
+            response.dump(_logger, transactionId());
+    }
+
+    if (!_httpSocket) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpServerTask::operator()()
+{
+    using Clock = std::chrono::steady_clock;
+
+    // The first request header is timed from the connection on
+    Clock::time_point deadline = Clock::now() + _timeouts.header;
+
+    while (true) {
+        if (hasPendingRequest()) {
+            if (!serve())
+                return;
+
+            // The following one from its first byte on
+            deadline = Clock::now()
+                + (isIdle() ? _timeouts.idle : _timeouts.header);
+
+            updateStats();
+            continue;
+        }
+
+        const bool idle = isIdle();
+        const auto timeout = deadline - Clock::now();
+
+        auto recvEv = _socketHandle->waitForRecvEvent(
+            std::chrono::duration_cast<TransportSocket::TimeoutInterval>(
+                std::max(timeout, decltype(timeout)::zero())));
+
+        if (recvEv != TransportSocket::RecvEvent::RECV_DATA || !receive()) {
+            close();
+            return;
+        }
+
+        if (idle && !isIdle()) {
+            deadline = Clock::now() + _timeouts.header;
+            updateStats();
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpServerTask::close()
+{
+    _closed = true;
+    _stats.setIdle(false);
+    _socketHandle->shutdown();
+
+    if (_verboseModeOn)
+        Tools::writeLog(
+            _logger, transactionId() + "---- http_server_task -\n\n");
+}
@@ -12,7 +12,9 @@
 #include "HttpSocket.h"
 #include "Tools.h"
 
-#include <vector>
+#include <algorithm>
+
+#include <errno.h>
 
 
 /* -------------------------------------------------------------------------- */
@@ -26,115 +28,155 @@ HttpSocket& HttpSocket::operator=(TcpSocket::Handle handle)
 
 /* -------------------------------------------------------------------------- */
 
-HttpRequest::Handle HttpSocket::recv()
+void HttpSocket::recv(HttpRequest& request)
 {
-    HttpRequest::Handle handle(new HttpRequest);
+    // The previous request is not referred anymore
+    _rxBuffer.erase(0, _rxConsumed);
+    _rxConsumed = 0;
 
-    char c = 0;
-    int ret = 1;
+    // Nor the previous responses, once sent
+    if (_txQueue.empty())
+        _arena.reset();
 
-    enum class CrLfSeq { CR1, LF1, CR2, LF2, IDLE } s = CrLfSeq::IDLE;
+    char buffer[HTTP_SERVER_RX_BUF_SIZE];
 
-    auto crlf = [&s](char c) -> bool {
-        switch (s) {
-        case CrLfSeq::IDLE:
-            s = (c == '\r') ? CrLfSeq::CR1 : CrLfSeq::IDLE;
-            break;
-        case CrLfSeq::CR1:
-            s = (c == '\n') ? CrLfSeq::LF1 : CrLfSeq::IDLE;
-            break;
-        case CrLfSeq::LF1:
-            s = (c == '\r') ? CrLfSeq::CR2 : CrLfSeq::IDLE;
-            break;
-        case CrLfSeq::CR2:
-            s = (c == '\n') ? CrLfSeq::LF2 : CrLfSeq::IDLE;
-            break;
-        default:
-            break;
-        }
-
-        return s == CrLfSeq::LF2;
-    };
+    // Bytes already searched for the end of header (CRLF twice)
+    std::string::size_type scanned = 0;
 
-    std::string line;
+    // The whole header has to be received in time, however it is split
+    const auto deadline = std::chrono::steady_clock::now() + _headerTimeout;
 
-    while (ret > 0 && _connUp && _socketHandle) {
-        std::chrono::seconds sec(getConnectionTimeout());
+    while (_connUp && _socketHandle) {
+        std::string::size_type pos =
+            CharScanner::findHeaderEnd(_rxBuffer, scanned);
 
-        auto recvEv = _socketHandle->waitForRecvEvent(sec);
+        if (pos != std::string::npos) {
+            // Keep the CRLF of the last header line, drop the empty line.
+            // The request refers to the buffer, so the header is dropped
+            // when next request is received.
+            request.parse(std::string_view(_rxBuffer).substr(0, pos + 2));
+            _rxConsumed = pos + 4;
+            _rxTime = HttpStats::Clock::now();
+            break;
+        }
 
-        switch (recvEv) {
-        case TransportSocket::RecvEvent::RECV_ERROR:
-        case TransportSocket::RecvEvent::TIMEOUT:
+        if (_rxBuffer.size() > HTTP_SERVER_MAX_HEADER_SIZE) {
             _connUp = false;
             break;
-        default:
-            break;
         }
 
-        if (!_connUp)
-            break;
+        scanned = _rxBuffer.size();
+
+        auto timeout = deadline - std::chrono::steady_clock::now();
 
-        ret = _socketHandle->recv(&c, 1);
+        auto recvEv = _socketHandle->waitForRecvEvent(
+            std::chrono::duration_cast<TransportSocket::TimeoutInterval>(
+                std::max(timeout, decltype(timeout)::zero())));
 
-        if (ret > 0) {
-            line += c;
-        } else if (ret <= 0) {
+        if (recvEv != TransportSocket::RecvEvent::RECV_DATA) {
             _connUp = false;
             break;
         }
 
-        if (crlf(c)) {
+        int ret = _socketHandle->recv(buffer, sizeof(buffer));
+
+        if (ret <= 0) {
+            _connUp = false;
             break;
         }
 
-        if (s == CrLfSeq::LF1) {
-            if (!line.empty()) {
-                handle->addHeader(line);
-                line.clear();
-            }
-        }
+        _rxBuffer.append(buffer, ret);
     }
+}
 
-    if (ret < 0 || !_socketHandle || handle->get_header().empty()) {
-        return handle;
-    }
 
-    std::string request = *handle->get_header().cbegin();
-    std::vector<std::string> tokens;
+/* -------------------------------------------------------------------------- */
 
-    if (!Tools::splitLineInTokens(request, tokens, " ")) {
-        return handle;
-    }
+bool HttpSocket::receive()
+{
+#ifdef MSG_DONTWAIT
+    const int flags = MSG_DONTWAIT;
+#else
+    const int flags = 0;
+#endif
+
+    char buffer[HTTP_SERVER_RX_BUF_SIZE];
 
-    if (tokens.size() != 3) {
-        return handle;
+    int ret = _connUp && _socketHandle 
+        ? _socketHandle->recv(buffer, sizeof(buffer), flags) 
+        : -1;
+
+    // Nothing available yet
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return true;
+
+    if (ret <= 0) {
+        _connUp = false;
+        return false;
     }
 
-    handle->parseMethod(tokens[0]);
-    handle->parseUri(tokens[1]);
-    handle->parseVersion(tokens[2]);
+    _rxBuffer.append(buffer, ret);
+
+    if (_rxBuffer.size() - _rxConsumed > HTTP_SERVER_MAX_HEADER_SIZE 
+        && !hasPendingRequest()) 
+    {
+        _connUp = false;
+        return false;
+    }
 
-    return handle;
+    return true;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-HttpSocket& HttpSocket::operator<<(const HttpResponse& response)
+void HttpSocket::flush(int flags)
 {
-    const std::string& response_txt = response;
-    size_t to_send = response_txt.size();
-
-    while (to_send > 0) {
-        int sent = _socketHandle->send(response);
-        if (sent < 0) {
+    while (!_txQueue.empty()) {
+        if (_txQueue.send(*_socketHandle, flags) < 0) {
+            _txQueue.clear();
             _connUp = false;
             break;
         }
-        to_send -= sent;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpSocket& HttpSocket::operator<<(const HttpResponse& response)
+{
+    // A body held in memory is sent together with the header in a
+    // single gathered write, along with the other queued responses.
+    _txQueue.push(response, _rxTime);
+
+    // The header of a body which is going to be sent from file is 
+    // corked, so that it leaves along with the first bytes of the file
+    // rather than in a segment of its own.
+    if (response.hasFileBody())
+        flush(TransportSocket::SEND_MORE);
+    else if (!hasPendingRequest() 
+        || _txQueue.size() >= HTTP_SERVER_PIPELINE_DEPTH) 
+    {
+        flush(0);
     }
 
     return *this;
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+int64_t HttpSocket::sendFile(const HttpResponse& response)
+{
+    int64_t sent = _socketHandle->sendFile(response.getFileEntry()->getFd(), 
+        response.getBodyOffset(), response.getBodySize());
+
+    if (sent > 0)
+        HttpStats::countBytesSent(uint64_t(sent));
+
+    if (sent >= 0)
+        HttpStats::countResponse(HttpStats::Clock::now() - _rxTime);
+
+    return sent;
+}
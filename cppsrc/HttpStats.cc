@@ -0,0 +1,517 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpStats.h"
+
+#include <algorithm>
+#include <atomic>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+
+/* -------------------------------------------------------------------------- */
+
+// Counter written by a single thread: it is incremented by a plain
+// load and store, while other threads can still read it safely
+class Counter {
+public:
+    void add(uint64_t n = 1) noexcept {
+        _value.store(
+            _value.load(std::memory_order_relaxed) + n,
+            std::memory_order_relaxed);
+    }
+
+    uint64_t get() const noexcept {
+        return _value.load(std::memory_order_relaxed);
+    }
+
+    // Only used on the retired counters, under lock
+    void merge(const Counter& other) noexcept {
+        add(other.get());
+    }
+
+private:
+    std::atomic<uint64_t> _value { 0 };
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+// Log-linear histogram of durations in microseconds, as the HDR ones:
+// each power of two is split in SUB_BUCKETS buckets, so that a value
+// is recorded with a relative error below 1 / SUB_BUCKETS, from 1us up
+// to 2^MAX_BITS us (about 2 minutes); longer ones only count in +Inf
+class Histogram {
+public:
+    enum {
+        SUB_BITS = 2,
+        SUB_BUCKETS = 1 << SUB_BITS,
+        MAX_BITS = 27,
+        BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS
+    };
+
+    void add(uint64_t usecs) noexcept {
+        const int index = indexOf(usecs);
+
+        if (index < BUCKETS)
+            _buckets[index].add();
+
+        _count.add();
+        _sum.add(usecs);
+    }
+
+    void merge(const Histogram& other) noexcept {
+        for (int i = 0; i < BUCKETS; ++i)
+            _buckets[i].merge(other._buckets[i]);
+
+        _count.merge(other._count);
+        _sum.merge(other._sum);
+    }
+
+    uint64_t getBucket(int index) const noexcept {
+        return _buckets[index].get();
+    }
+
+    uint64_t getCount() const noexcept {
+        return _count.get();
+    }
+
+    uint64_t getSum() const noexcept {
+        return _sum.get();
+    }
+
+    // Returns the smallest value greater than the ones of a bucket
+    static uint64_t upperBound(int index) noexcept {
+        if (index < SUB_BUCKETS)
+            return uint64_t(index) + 1;
+
+        const int shift = index / SUB_BUCKETS - 1;
+        const uint64_t first = uint64_t(SUB_BUCKETS + index % SUB_BUCKETS);
+
+        return (first + 1) << shift;
+    }
+
+private:
+    Counter _buckets[BUCKETS];
+    Counter _count;
+    Counter _sum; // usecs
+
+    static int indexOf(uint64_t usecs) noexcept {
+        if (usecs < SUB_BUCKETS)
+            return int(usecs);
+
+        if (usecs >> MAX_BITS)
+            return BUCKETS;
+
+        int msb = 63;
+
+        while (!(usecs >> msb))
+            --msb;
+
+        // The most significant bits select the sub-bucket
+        const int shift = msb - SUB_BITS;
+
+        return (shift + 1) * SUB_BUCKETS
+            + int(usecs >> shift) - SUB_BUCKETS;
+    }
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+// Methods and status codes the requests are counted by
+const char* const methodNames[] = { "GET", "HEAD", "POST", "other" };
+const int statusCodes[] = { 200, 206, 304, 403, 404, 416, 0 };
+const char* const cacheNames[] = { "file", "content", "gzip" };
+
+enum {
+    METHODS = sizeof(methodNames) / sizeof(methodNames[0]),
+    STATUSES = sizeof(statusCodes) / sizeof(statusCodes[0]),
+    CACHES = sizeof(cacheNames) / sizeof(cacheNames[0])
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+// Formats a number of microseconds in seconds
+std::string formatSeconds(uint64_t usecs)
+{
+    std::string fraction = std::to_string(usecs % 1000000);
+    fraction.insert(0, 6 - fraction.size(), '0');
+
+    return std::to_string(usecs / 1000000) + "." + fraction;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace
+
+
+/* -------------------------------------------------------------------------- */
+
+// Aligned, so that the counters of different threads do not share
+// cache lines
+struct alignas(64) HttpStats::Counters {
+    Counter requests[METHODS][STATUSES];
+    Counter bytesSent;
+    Counter connectionsOpened;
+    Counter connectionsClosed;
+    Counter idleEntered;
+    Counter idleLeft;
+    Counter acceptErrors;
+    Counter accessLogDrops;
+    Counter cacheHits[CACHES];
+    Counter cacheMisses[CACHES];
+    Histogram firstByte;
+    Histogram response;
+
+    void merge(const Counters& other) noexcept {
+        for (int m = 0; m < METHODS; ++m) {
+            for (int s = 0; s < STATUSES; ++s)
+                requests[m][s].merge(other.requests[m][s]);
+        }
+
+        bytesSent.merge(other.bytesSent);
+        connectionsOpened.merge(other.connectionsOpened);
+        connectionsClosed.merge(other.connectionsClosed);
+        idleEntered.merge(other.idleEntered);
+        idleLeft.merge(other.idleLeft);
+        acceptErrors.merge(other.acceptErrors);
+        accessLogDrops.merge(other.accessLogDrops);
+
+        for (int c = 0; c < CACHES; ++c) {
+            cacheHits[c].merge(other.cacheHits[c]);
+            cacheMisses[c].merge(other.cacheMisses[c]);
+        }
+
+        firstByte.merge(other.firstByte);
+        response.merge(other.response);
+    }
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+auto HttpStats::getInstance() -> HttpStats&
+{
+    static HttpStats instance;
+    return instance;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpStats::HttpStats()
+    : _retiredCounters(new Counters)
+{
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpStats::~HttpStats() = default;
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpStats::Counters& HttpStats::getThreadCounters() noexcept
+{
+    // Created by the first count of a thread, merged into the
+    // retired counters when the thread terminates
+    struct ThreadCounters {
+        Counters* counters = new Counters;
+
+        ThreadCounters() {
+            getInstance().attach(counters);
+        }
+
+        ~ThreadCounters() {
+            getInstance().detach(counters);
+        }
+    };
+
+    thread_local ThreadCounters threadCounters;
+
+    return *threadCounters.counters;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::attach(Counters* counters)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    _threadCounters.push_back(counters);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::detach(Counters* counters) noexcept
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    _threadCounters.erase(
+        std::find(_threadCounters.begin(), _threadCounters.end(), counters));
+
+    _retiredCounters->merge(*counters);
+
+    delete counters;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::countRequest(
+    HttpRequest::Method method, int statusCode) noexcept
+{
+    int m = std::min(int(method), int(METHODS) - 1);
+    int s = 0;
+
+    // The last entry collects the other status codes
+    while (statusCodes[s] && statusCodes[s] != statusCode)
+        ++s;
+
+    getThreadCounters().requests[m][s].add();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::countFirstByte(Clock::duration latency) noexcept
+{
+    getThreadCounters().firstByte.add(uint64_t(std::max(int64_t(0),
+        int64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+            latency).count()))));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::countResponse(Clock::duration latency) noexcept
+{
+    getThreadCounters().response.add(uint64_t(std::max(int64_t(0),
+        int64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+            latency).count()))));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::countBytesSent(uint64_t bytes) noexcept
+{
+    getThreadCounters().bytesSent.add(bytes);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::countAcceptError() noexcept
+{
+    getThreadCounters().acceptErrors.add();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::countAccessLogDrop() noexcept
+{
+    getThreadCounters().accessLogDrops.add();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::countCacheLookup(Cache cache, bool hit) noexcept
+{
+    Counters& counters = getThreadCounters();
+
+    if (hit)
+        counters.cacheHits[int(cache)].add();
+    else
+        counters.cacheMisses[int(cache)].add();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpStats::Connection::Connection() noexcept
+{
+    getThreadCounters().connectionsOpened.add();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+HttpStats::Connection::~Connection()
+{
+    setIdle(false);
+    getThreadCounters().connectionsClosed.add();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::Connection::setIdle(bool idle) noexcept
+{
+    if (idle == _idle)
+        return;
+
+    _idle = idle;
+
+    if (idle)
+        getThreadCounters().idleEntered.add();
+    else
+        getThreadCounters().idleLeft.add();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpStats::format(std::string& output) const
+{
+    Counters total;
+
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        total.merge(*_retiredCounters);
+
+        for (const Counters* counters : _threadCounters)
+            total.merge(*counters);
+    }
+
+    // Counters of different threads are not read at the same instant:
+    // a gauge may be momentarily off by the connections just closed
+    auto gauge = [](const Counter& up, const Counter& down) {
+        return up.get() > down.get() ? up.get() - down.get() : 0;
+    };
+
+    auto header = [&output](
+        const char* name, const char* type, const char* help)
+    {
+        output += "# HELP ";
+        output += name;
+        output += " ";
+        output += help;
+        output += "\n# TYPE ";
+        output += name;
+        output += " ";
+        output += type;
+        output += "\n";
+    };
+
+    auto histogram = [&](const char* name, const Histogram& h) {
+        uint64_t cumulative = 0;
+
+        for (int i = 0; i < Histogram::BUCKETS; ++i) {
+            cumulative += h.getBucket(i);
+
+            output += name;
+            output += "_bucket{le=\""
+                + formatSeconds(Histogram::upperBound(i)) + "\"} "
+                + std::to_string(cumulative) + "\n";
+        }
+
+        output += name;
+        output += "_bucket{le=\"+Inf\"} " + std::to_string(h.getCount());
+        output += "\n";
+        output += name;
+        output += "_sum " + formatSeconds(h.getSum()) + "\n";
+        output += name;
+        output += "_count " + std::to_string(h.getCount()) + "\n";
+    };
+
+    output.clear();
+
+    header("thttpd_requests_total", "counter",
+        "Requests served, by method and status code.");
+
+    for (int m = 0; m < METHODS; ++m) {
+        for (int s = 0; s < STATUSES; ++s) {
+            const uint64_t count = total.requests[m][s].get();
+
+            if (!count)
+                continue;
+
+            output += "thttpd_requests_total{method=\"";
+            output += methodNames[m];
+            output += "\",code=\"";
+            output += statusCodes[s] ? std::to_string(statusCodes[s]) : "other";
+            output += "\"} " + std::to_string(count) + "\n";
+        }
+    }
+
+    header("thttpd_sent_bytes_total", "counter",
+        "Bytes sent to the clients.");
+    output += "thttpd_sent_bytes_total "
+        + std::to_string(total.bytesSent.get()) + "\n";
+
+    header("thttpd_connections_total", "counter",
+        "Connections accepted.");
+    output += "thttpd_connections_total "
+        + std::to_string(total.connectionsOpened.get()) + "\n";
+
+    header("thttpd_accepted_total", "counter",
+        "Connections accepted, by listener shard.");
+
+    for (size_t shard = 0; shard < _listeners.size(); ++shard) {
+        output += "thttpd_accepted_total{shard=\"" + std::to_string(shard)
+            + "\"} " + std::to_string(_listeners[shard]->getAcceptCount())
+            + "\n";
+    }
+
+    header("thttpd_connections_active", "gauge",
+        "Connections open.");
+    output += "thttpd_connections_active " + std::to_string(
+        gauge(total.connectionsOpened, total.connectionsClosed)) + "\n";
+
+    header("thttpd_connections_idle", "gauge",
+        "Keep-alive connections waiting for a new request.");
+    output += "thttpd_connections_idle " + std::to_string(
+        gauge(total.idleEntered, total.idleLeft)) + "\n";
+
+    header("thttpd_accept_errors_total", "counter",
+        "Connections failed to be accepted.");
+    output += "thttpd_accept_errors_total "
+        + std::to_string(total.acceptErrors.get()) + "\n";
+
+    header("thttpd_access_log_dropped_total", "counter",
+        "Requests not logged, as the access log was full.");
+    output += "thttpd_access_log_dropped_total "
+        + std::to_string(total.accessLogDrops.get()) + "\n";
+
+    header("thttpd_cache_lookups_total", "counter",
+        "Cache lookups, by cache and result.");
+
+    for (int c = 0; c < CACHES; ++c) {
+        output += "thttpd_cache_lookups_total{cache=\"";
+        output += cacheNames[c];
+        output += "\",result=\"hit\"} "
+            + std::to_string(total.cacheHits[c].get()) + "\n";
+        output += "thttpd_cache_lookups_total{cache=\"";
+        output += cacheNames[c];
+        output += "\",result=\"miss\"} "
+            + std::to_string(total.cacheMisses[c].get()) + "\n";
+    }
+
+    header("thttpd_first_byte_seconds", "histogram",
+        "Time from a request to the first byte of its response.");
+    histogram("thttpd_first_byte_seconds", total.firstByte);
+
+    header("thttpd_response_seconds", "histogram",
+        "Time from a request to the last byte of its response.");
+    histogram("thttpd_response_seconds", total.response);
+}
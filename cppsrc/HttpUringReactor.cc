@@ -0,0 +1,538 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpUringReactor.h"
+
+#ifdef HTTP_SERVER_IO_URING_SUPPORT
+
+#include "HttpStats.h"
+#include "Tools.h"
+
+#include <cstring>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+/* -------------------------------------------------------------------------- */
+
+// Submits an operation and reaps its first completion
+static bool probeOperation(IoUring& ring, const IoUring::Submission& op,
+    IoUring::Completion& result)
+{
+    IoUring::Submission* sqe = ring.getSubmission();
+
+    if (!sqe)
+        return false;
+
+    *sqe = op;
+
+    bool completed = false;
+
+    // The operations probed complete at once, a short wait is enough
+    for (int attempt = 0; attempt < 10 && !completed; ++attempt) {
+        if (ring.submitAndWait(std::chrono::milliseconds(100)) < 0)
+            return false;
+
+        ring.forEachCompletion([&](const IoUring::Completion& cqe) {
+            if (cqe.user_data == op.user_data && !completed) {
+                result = cqe;
+                completed = true;
+            }
+        });
+    }
+
+    return completed;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Multishot accept and recv are requested by flags, which the kernel
+// does not report: they are tried on a pair of local sockets, with
+// data waiting to be received, and rejected with -EINVAL by kernels
+// lacking them
+static bool probeMultishot(IoUring& ring, uint16_t bufferGroup)
+{
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    socklen_t addrLen = sizeof(addr.sun_family);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int client = -1;
+    int server = -1;
+
+    // The listener is bound to an address picked by the system
+    bool ok = listener >= 0
+        && ::bind(listener, reinterpret_cast<sockaddr*>(&addr), addrLen) == 0
+        && (addrLen = sizeof(addr), true)
+        && ::getsockname(
+            listener, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0
+        && ::listen(listener, 1) == 0
+        && (client = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) >= 0
+        && ::connect(
+            client, reinterpret_cast<sockaddr*>(&addr), addrLen) == 0
+        && ::send(client, "", 1, MSG_NOSIGNAL) == 1;
+
+    IoUring::Submission op {};
+    IoUring::Completion cqe {};
+
+    if (ok) {
+        op.opcode = IORING_OP_ACCEPT;
+        op.fd = listener;
+        op.ioprio = IORING_ACCEPT_MULTISHOT;
+        op.accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        op.user_data = 1;
+
+        ok = probeOperation(ring, op, cqe)
+            && cqe.res >= 0 && (cqe.flags & IORING_CQE_F_MORE);
+
+        server = ok ? cqe.res : -1;
+    }
+
+    if (ok) {
+        op = IoUring::Submission {};
+        op.opcode = IORING_OP_RECV;
+        op.fd = server;
+        op.ioprio = IORING_RECV_MULTISHOT;
+        op.flags = IOSQE_BUFFER_SELECT;
+        op.buf_group = bufferGroup;
+        op.user_data = 2;
+
+        ok = probeOperation(ring, op, cqe)
+            && cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE)
+            && (cqe.flags & IORING_CQE_F_BUFFER);
+    }
+
+    for (int sd : { server, client, listener }) {
+        if (sd >= 0)
+            ::close(sd);
+    }
+
+    return ok;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::isSupported()
+{
+    IoUring::Handle ring = IoUring::create(8);
+
+    if (!ring || !ring->isValid())
+        return false;
+
+    // Each operation the reactor uses is checked, rather than the
+    // kernel version, as some of them may be disabled by the system
+    return ring->isSupported(IORING_OP_ACCEPT)
+        && ring->isSupported(IORING_OP_RECV)
+        && ring->isSupported(IORING_OP_SENDMSG)
+        && ring->isSupported(IORING_OP_POLL_ADD)
+        && ring->isSupported(IORING_OP_TIMEOUT)
+        && ring->setupBufferRing(BUFFER_GROUP, 1, HTTP_SERVER_RX_BUF_SIZE)
+        && probeMultishot(*ring, BUFFER_GROUP);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::open()
+{
+    _ring = IoUring::create();
+
+    if (!_ring || !_ring->isValid()
+        || !_ring->setupBufferRing(
+            BUFFER_GROUP, HTTP_URING_BUFFERS, HTTP_SERVER_RX_BUF_SIZE)
+        || !_listener.setNonBlockingMode()
+        || !submitAccept())
+    {
+        _ring.reset();
+        return false;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::run()
+{
+    if (!_ring && !open())
+        return false;
+
+    while (true) {
+        // Timers are checked on every tick while any is pending
+        auto timeout = _timers.empty() 
+            ? TimerWheel::Duration(std::chrono::seconds(1))
+            : _timers.getResolution();
+
+        if (_ring->submitAndWait(timeout) < 0)
+            return false;
+
+        _ring->forEachCompletion([this](const IoUring::Completion& cqe) {
+            onCompletion(cqe);
+        });
+
+        expireConnections();
+    }
+
+    // Ok, following instruction won't be ever executed
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpUringReactor::onCompletion(const IoUring::Completion& cqe)
+{
+    const uint64_t op = cqe.user_data & OP_MASK;
+
+    if (op == OP_ACCEPT) {
+        onAccept(cqe);
+        return;
+    }
+
+    if (op == OP_BACKOFF) {
+        submitAccept();
+        return;
+    }
+
+    Context& ctx = *reinterpret_cast<Context*>(cqe.user_data & ~OP_MASK);
+    HttpConnection& connection = *ctx.connection;
+
+    switch (op) {
+    case OP_RECV:
+        onRecv(ctx, cqe);
+        break;
+
+    case OP_SEND:
+        --ctx.inFlight;
+        ctx.sendArmed = false;
+
+        if (cqe.res > 0 && !ctx.closing)
+            connection.onSent(size_t(cqe.res));
+        else
+            connection.close();
+        break;
+
+    case OP_POLL:
+        --ctx.inFlight;
+        ctx.pollArmed = false;
+        break;
+    }
+
+    service(ctx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpUringReactor::onAccept(const IoUring::Completion& cqe)
+{
+    bool backoff = false;
+
+    if (cqe.res >= 0) {
+        addConnection(_listener.adopt(cqe.res));
+    }
+    else if (cqe.res == -EMFILE || cqe.res == -ENFILE) {
+        HttpStats::countAcceptError();
+
+        // The ring allocates the descriptor before waiting for a
+        // connection, so the operation would fail again at once
+        // even with no connection pending
+        backoff = true;
+
+        // Out of descriptors: the listener drops the pending
+        // connections by using its reserved descriptor
+        while (true) {
+            TcpSocket::Handle handle = _listener.accept(true);
+
+            if (handle) {
+                addConnection(handle);
+            }
+            else if (errno == ECONNABORTED) {
+                HttpStats::countAcceptError();
+            }
+            else {
+                break;
+            }
+        }
+    }
+    else if (cqe.res != -ECANCELED) {
+        HttpStats::countAcceptError();
+
+        // Resources exhausted: retry shortly
+        backoff = cqe.res != -ECONNABORTED;
+    }
+
+    // Multishot operation terminated
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        if (!backoff || !submitAcceptBackoff())
+            submitAccept();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpUringReactor::onRecv(Context& ctx, const IoUring::Completion& cqe)
+{
+    HttpConnection& connection = *ctx.connection;
+
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        const uint16_t id = uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if (cqe.res > 0 && !ctx.closing)
+            connection.onRecvData(_ring->getBuffer(id), size_t(cqe.res));
+
+        _ring->recycleBuffer(id);
+    }
+
+    if (cqe.res == 0)
+        connection.onRecvClosed();
+    else if (cqe.res < 0 && cqe.res != -ENOBUFS)
+        connection.close();
+
+    // Multishot operation terminated: data is received again
+    // unless the connection is being closed
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        --ctx.inFlight;
+        ctx.recvArmed = false;
+
+        if (cqe.res != 0 && !ctx.closing
+            && connection.getState() != HttpConnection::State::CLOSED)
+        {
+            submitRecv(ctx);
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpUringReactor::addConnection(TcpSocket::Handle handle)
+{
+    const SocketFd sd = handle->getSocketFd();
+
+    std::unique_ptr<Context> ctx(new Context);
+
+    ctx->connection = HttpConnection::create(
+        handle, _webRootPath, _verboseModeOn, _logger);
+
+    if (!submitRecv(*ctx))
+        return;
+
+    ctx->connection->updateTimer(_timers, _timeouts);
+
+    _connections[sd] = std::move(ctx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpUringReactor::service(Context& ctx)
+{
+    HttpConnection& connection = *ctx.connection;
+
+    if (!ctx.closing && !ctx.sendArmed && !ctx.pollArmed) {
+        TransportSocket::Buffer buffers[TransportSocket::MAX_SEND_BUFFERS];
+
+        int count = connection.advance(
+            buffers, TransportSocket::MAX_SEND_BUFFERS);
+
+        if (count > 0) {
+            if (!submitSend(ctx, buffers, count, connection.getSendFlags()))
+                connection.close();
+        }
+        else if (connection.getState() == HttpConnection::State::SENDING_BODY) {
+            // File body is sent on socket writability
+            if (!submitPoll(ctx))
+                connection.close();
+        }
+    }
+
+    if (!ctx.closing)
+        connection.updateTimer(_timers, _timeouts);
+
+    if (connection.getState() == HttpConnection::State::CLOSED)
+        closeConnection(ctx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::submitAccept()
+{
+    IoUring::Submission* sqe = _ring->getSubmission();
+
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = _listener.getSocketFd();
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = OP_ACCEPT;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::submitAcceptBackoff()
+{
+    IoUring::Submission* sqe = _ring->getSubmission();
+
+    if (!sqe)
+        return false;
+
+    _backoff.tv_sec = HTTP_SERVER_ACCEPT_BACKOFF / 1000;
+    _backoff.tv_nsec = (HTTP_SERVER_ACCEPT_BACKOFF % 1000) * 1000000LL;
+
+    // Completed with -ETIME once the delay is elapsed
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = reinterpret_cast<uint64_t>(&_backoff);
+    sqe->len = 1;
+    sqe->user_data = OP_BACKOFF;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::submitRecv(Context& ctx)
+{
+    IoUring::Submission* sqe = _ring->getSubmission();
+
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = ctx.connection->getSocketFd();
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = reinterpret_cast<uint64_t>(&ctx) | OP_RECV;
+
+    ++ctx.inFlight;
+    ctx.recvArmed = true;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::submitSend(Context& ctx,
+    const TransportSocket::Buffer* buffers, int count, int flags)
+{
+    IoUring::Submission* sqe = _ring->getSubmission();
+
+    if (!sqe)
+        return false;
+
+    // The buffers must stay valid until the operation is completed:
+    // they belong to the queue of the connection, which is not
+    // changed meanwhile
+    for (int i = 0; i < count; ++i) {
+        ctx.iov[i].iov_base = const_cast<char*>(buffers[i].data);
+        ctx.iov[i].iov_len = buffers[i].size;
+    }
+
+    memset(&ctx.msg, 0, sizeof(ctx.msg));
+    ctx.msg.msg_iov = ctx.iov;
+    ctx.msg.msg_iovlen = count;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = ctx.connection->getSocketFd();
+    sqe->addr = reinterpret_cast<uint64_t>(&ctx.msg);
+    sqe->len = 1;
+    sqe->msg_flags = unsigned(flags);
+    sqe->user_data = reinterpret_cast<uint64_t>(&ctx) | OP_SEND;
+
+    ++ctx.inFlight;
+    ctx.sendArmed = true;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool HttpUringReactor::submitPoll(Context& ctx)
+{
+    IoUring::Submission* sqe = _ring->getSubmission();
+
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = ctx.connection->getSocketFd();
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = reinterpret_cast<uint64_t>(&ctx) | OP_POLL;
+
+    ++ctx.inFlight;
+    ctx.pollArmed = true;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpUringReactor::expireConnections()
+{
+    auto onExpired = [this](TimerWheel::Timer& timer) {
+        auto& connection = *static_cast<HttpConnection*>(timer.getContext());
+        auto it = _connections.find(connection.getSocketFd());
+
+        if (it != _connections.end() && !it->second->closing) {
+            connection.close();
+            closeConnection(*it->second);
+        }
+    };
+
+    _timers.advance(TimerWheel::Clock::now(), onExpired);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void HttpUringReactor::closeConnection(Context& ctx)
+{
+    const SocketFd sd = ctx.connection->getSocketFd();
+
+    if (!ctx.closing) {
+        ctx.closing = true;
+
+        // Pending operations are completed as soon as possible
+        ::shutdown(sd, SHUT_RDWR);
+
+        if (_verboseModeOn)
+            Tools::writeLog(_logger, "[" + std::to_string(sd)
+                + "] ---- http connection closed\n\n");
+    }
+
+    // The socket is closed along with the connection
+    if (!ctx.inFlight)
+        _connections.erase(sd);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_IO_URING_SUPPORT
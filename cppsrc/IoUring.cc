@@ -0,0 +1,297 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "IoUring.h"
+
+#ifdef HTTP_SERVER_IO_URING_SUPPORT
+
+#include <algorithm>
+#include <cstring>
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+/* -------------------------------------------------------------------------- */
+
+IoUring::IoUring(unsigned entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    _ringFd = int(::syscall(__NR_io_uring_setup, entries, &params));
+
+    if (_ringFd < 0)
+        return;
+
+    _features = params.features;
+
+    if (!mapRings(params)) {
+        ::close(_ringFd);
+        _ringFd = -1;
+        return;
+    }
+
+    // Supported operations
+    const size_t probeSize = sizeof(io_uring_probe)
+        + 256 * sizeof(io_uring_probe_op);
+
+    _probe.reset(new uint8_t[probeSize]());
+
+    if (::syscall(__NR_io_uring_register, _ringFd, IORING_REGISTER_PROBE,
+        _probe.get(), 256) < 0)
+    {
+        _probe.reset();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+IoUring::~IoUring()
+{
+    if (_bufRing)
+        ::munmap(_bufRing, _bufRingSize);
+
+    if (_sqes)
+        ::munmap(_sqes, _sqesSize);
+
+    if (_cqRing && _cqRing != _sqRing)
+        ::munmap(_cqRing, _cqRingSize);
+
+    if (_sqRing)
+        ::munmap(_sqRing, _sqRingSize);
+
+    if (isValid())
+        ::close(_ringFd);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool IoUring::mapRings(const io_uring_params& params)
+{
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(Completion);
+
+    // Both the rings may be mapped at once
+    if (_features & IORING_FEAT_SINGLE_MMAP)
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+
+    void* ptr = ::mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+
+    if (ptr == MAP_FAILED)
+        return false;
+
+    _sqRing = ptr;
+
+    if (_features & IORING_FEAT_SINGLE_MMAP) {
+        _cqRing = _sqRing;
+    }
+    else {
+        ptr = ::mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+
+        if (ptr == MAP_FAILED)
+            return false;
+
+        _cqRing = ptr;
+    }
+
+    _sqesSize = params.sq_entries * sizeof(Submission);
+
+    ptr = ::mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+
+    if (ptr == MAP_FAILED)
+        return false;
+
+    _sqes = static_cast<Submission*>(ptr);
+
+    auto field = [](void* ring, unsigned offset) {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+    };
+
+    _sqHead = field(_sqRing, params.sq_off.head);
+    _sqTail = field(_sqRing, params.sq_off.tail);
+    _sqMask = field(_sqRing, params.sq_off.ring_mask);
+    _sqEntries = params.sq_entries;
+
+    // Each slot of the submission queue refers to the entry
+    // having the same index
+    unsigned* sqArray = field(_sqRing, params.sq_off.array);
+
+    for (unsigned i = 0; i < _sqEntries; ++i)
+        sqArray[i] = i;
+
+    _sqLocalTail = *_sqTail;
+
+    _cqHead = field(_cqRing, params.cq_off.head);
+    _cqTail = field(_cqRing, params.cq_off.tail);
+    _cqMask = field(_cqRing, params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<Completion*>(
+        static_cast<char*>(_cqRing) + params.cq_off.cqes);
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool IoUring::isSupported(unsigned opcode) const noexcept
+{
+    if (!_probe)
+        return false;
+
+    auto probe = reinterpret_cast<const io_uring_probe*>(_probe.get());
+
+    return opcode <= probe->last_op
+        && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int IoUring::enter(unsigned minComplete, unsigned flags,
+    const void* arg, size_t argSize) noexcept
+{
+    // Entries are made visible to the kernel before the system call
+    __atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+
+    const unsigned toSubmit = 
+        _sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+
+    return int(::syscall(__NR_io_uring_enter, _ringFd, toSubmit,
+        minComplete, flags, arg, argSize));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+IoUring::Submission* IoUring::getSubmission() noexcept
+{
+    unsigned head = __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+
+    if (_sqLocalTail - head >= _sqEntries) {
+        // Queue full: make room by submitting it
+        if (enter(0, 0) < 0)
+            return nullptr;
+
+        head = __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+
+        if (_sqLocalTail - head >= _sqEntries)
+            return nullptr;
+    }
+
+    Submission* sqe = &_sqes[_sqLocalTail & *_sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+
+    ++_sqLocalTail;
+
+    return sqe;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int IoUring::submitAndWait(const TimeoutInterval& timeout) noexcept
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout);
+
+    __kernel_timespec ts {};
+    ts.tv_sec = ns.count() / 1000000000;
+    ts.tv_nsec = ns.count() % 1000000000;
+
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    int ret = enter(1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+        &arg, sizeof(arg));
+
+    // Expiration of time limit and signals are not errors
+    if (ret < 0 && (errno == ETIME || errno == EINTR || errno == EBUSY))
+        return 0;
+
+    return ret < 0 ? -1 : 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool IoUring::setupBufferRing(uint16_t groupId, unsigned count, unsigned size)
+{
+    if (!isValid() || _bufRing || !count || (count & (count - 1)))
+        return false;
+
+    _bufRingSize = count * sizeof(io_uring_buf);
+
+    void* ptr = ::mmap(nullptr, _bufRingSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ptr == MAP_FAILED)
+        return false;
+
+    _bufRing = static_cast<io_uring_buf_ring*>(ptr);
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(_bufRing);
+    reg.ring_entries = count;
+    reg.bgid = groupId;
+
+    if (::syscall(__NR_io_uring_register, _ringFd,
+        IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        ::munmap(_bufRing, _bufRingSize);
+        _bufRing = nullptr;
+        return false;
+    }
+
+    _buffers.reset(new char[size_t(count) * size]);
+    _bufferCount = count;
+    _bufferSize = size;
+    _bufTail = 0;
+
+    for (unsigned id = 0; id < count; ++id)
+        recycleBuffer(uint16_t(id));
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void IoUring::recycleBuffer(uint16_t id) noexcept
+{
+    // The entries are overlaid with the ring header: bufs is not used,
+    // as its flexible array declaration is misplaced when compiled as C++
+    io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(_bufRing)
+        [_bufTail & (_bufferCount - 1)];
+
+    buf.addr = reinterpret_cast<uint64_t>(getBuffer(id));
+    buf.len = _bufferSize;
+    buf.bid = id;
+
+    ++_bufTail;
+
+    __atomic_store_n(&_bufRing->tail, _bufTail, __ATOMIC_RELEASE);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_IO_URING_SUPPORT
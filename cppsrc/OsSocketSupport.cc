@@ -11,6 +11,10 @@
 
 #include "OsSocketSupport.h"
 
+#ifndef _MSC_VER
+#include <signal.h>
+#endif
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -61,6 +65,9 @@ int OsSocketSupport::closeSocketFd(int sd) {
 /* -------------------------------------------------------------------------- */
 
 bool OsSocketSupport::initSocketLibrary(std::string&) { 
+    // A peer closing the connection while a response is being sent 
+    // must not terminate the process: let send/sendfile fail with EPIPE
+    ::signal(SIGPIPE, SIG_IGN);
     return true; 
 }
 
@@ -15,14 +15,60 @@
 #include <string.h>
 #include <thread>
 
+#include <errno.h>
+#include <fcntl.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
 
 /* -------------------------------------------------------------------------- */
 
 TcpListener::TcpListener()
     : TransportSocket(int(::socket(AF_INET, SOCK_STREAM, 0)))
     , _status(isValid() ? Status::VALID : Status::INVALID)
+    , _acceptCount(0)
 {
     memset(&_local_ip_port_sa_in, 0, sizeof(_local_ip_port_sa_in));
+    openReservedFd();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+TcpListener::~TcpListener()
+{
+#ifndef WIN32
+    if (_reservedFd >= 0)
+        ::close(_reservedFd);
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void TcpListener::openReservedFd() noexcept
+{
+#ifndef WIN32
+    if (_reservedFd < 0)
+        _reservedFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool TcpListener::setReusePort(bool on) noexcept
+{
+#ifdef HTTP_SERVER_REUSEPORT_SUPPORT
+    int optval = on ? 1 : 0;
+
+    return 0 == ::setsockopt(
+        getSocketFd(), SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
+#else
+    return !on;
+#endif
 }
 
 
@@ -46,24 +92,127 @@ bool TcpListener::bind(const std::string& ip, const TranspPort& port)
 
 /* -------------------------------------------------------------------------- */
 
-TcpSocket::Handle TcpListener::accept()
+TcpListener::SocketFd TcpListener::acceptFd(
+    sockaddr* remote_sockaddr, bool nonBlocking) noexcept
+{
+    socklen_t sockaddrlen = sizeof(struct sockaddr);
+
+#ifdef HTTP_SERVER_ACCEPT4_SUPPORT
+    // Flags are set by the same system call
+    return int(::accept4(getSocketFd(), remote_sockaddr, &sockaddrlen,
+        SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0)));
+#else
+    SocketFd sd = int(::accept(getSocketFd(), remote_sockaddr, &sockaddrlen));
+
+    // The new socket may inherit the mode of the listener
+    if (sd > 0) {
+#ifdef WIN32
+        u_long mode = nonBlocking ? 1 : 0;
+        ::ioctlsocket(sd, FIONBIO, &mode);
+#else
+        int flags = ::fcntl(sd, F_GETFL, 0);
+
+        if (flags >= 0) {
+            ::fcntl(sd, F_SETFL, 
+                nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+        }
+
+        ::fcntl(sd, F_SETFD, FD_CLOEXEC);
+#endif
+    }
+
+    return sd;
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool TcpListener::dropConnection() noexcept
+{
+#ifdef WIN32
+    return false;
+#else
+    if (_reservedFd < 0)
+        return false;
+
+    ::close(_reservedFd);
+    _reservedFd = -1;
+
+    sockaddr remote_sockaddr {};
+    socklen_t sockaddrlen = sizeof(struct sockaddr);
+
+    int sd = ::accept(getSocketFd(), &remote_sockaddr, &sockaddrlen);
+    int err = errno;
+
+    if (sd >= 0)
+        ::close(sd);
+
+    openReservedFd();
+
+    errno = err;
+
+    return sd >= 0;
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+TcpSocket::Handle TcpListener::accept(bool nonBlocking)
 {
     if (getStatus() != Status::VALID)
         return TcpSocket::Handle();
 
-    sockaddr remote_sockaddr = { 0 };
+    sockaddr remote_sockaddr {};
 
     struct sockaddr* local_sockaddr
         = reinterpret_cast<struct sockaddr*>(&_local_ip_port_sa_in);
 
-    socklen_t sockaddrlen = sizeof(struct sockaddr);
+    SocketFd sd = acceptFd(&remote_sockaddr, nonBlocking);
+
+    if (sd < 0 && (errno == EMFILE || errno == ENFILE)) {
+        // Out of descriptors: the client is disconnected
+        // rather than left in the queue
+        if (dropConnection())
+            errno = ECONNABORTED;
+
+        return TcpSocket::Handle();
+    }
+
+    // Errors related to the pending connection rather than 
+    // to the listener are reported in the same way
+    if (sd < 0 && (errno == EINTR || errno == EPROTO))
+        errno = ECONNABORTED;
 
-    SocketFd sd = int(::accept(getSocketFd(), &remote_sockaddr, &sockaddrlen));
+    // The reserved descriptor may be missing after exhaustion
+    openReservedFd();
 
     TcpSocket::Handle handle = TcpSocket::Handle(sd > 0
             ? new TcpSocket(sd, local_sockaddr, &remote_sockaddr)
             : nullptr);
 
+    if (handle)
+        _acceptCount.fetch_add(1, std::memory_order_relaxed);
+
     return handle;
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+TcpSocket::Handle TcpListener::adopt(SocketFd sd)
+{
+    sockaddr remote_sockaddr {};
+    socklen_t sockaddrlen = sizeof(struct sockaddr);
+
+    ::getpeername(sd, &remote_sockaddr, &sockaddrlen);
+
+    struct sockaddr* local_sockaddr
+        = reinterpret_cast<struct sockaddr*>(&_local_ip_port_sa_in);
+
+    _acceptCount.fetch_add(1, std::memory_order_relaxed);
+
+    return TcpSocket::Handle(
+        new TcpSocket(sd, local_sockaddr, &remote_sockaddr));
+}
@@ -0,0 +1,138 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "ThreadPool.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+// Identifies the pool and the queue of the calling worker thread
+static thread_local ThreadPool* tl_workerPool = nullptr;
+static thread_local size_t tl_workerIndex = 0;
+
+
+/* -------------------------------------------------------------------------- */
+
+ThreadPool::ThreadPool(size_t threads)
+    : _pending(0)
+    , _nextQueue(0)
+{
+    if (!threads)
+        threads = std::thread::hardware_concurrency();
+
+    if (!threads)
+        threads = 1;
+
+    for (size_t i = 0; i < threads; ++i)
+        _queues.emplace_back(new WorkQueue);
+
+    for (size_t i = 0; i < threads; ++i)
+        _workers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+
+    _cv.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void ThreadPool::submit(Task task)
+{
+    size_t index = tl_workerPool == this
+        ? tl_workerIndex
+        : _nextQueue++ % _queues.size();
+
+    // Counter is updated under the pool mutex so that a worker
+    // cannot miss the notification between its check and its wait,
+    // and before the task is published so that a worker popping it
+    // never decrements the counter below zero
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        ++_pending;
+
+        WorkQueue& queue = *_queues[index];
+        std::lock_guard<std::mutex> queueLock(queue.mtx);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    _cv.notify_one();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool ThreadPool::popTask(size_t index, Task& task)
+{
+    // Own queue first, newest task (LIFO)
+    {
+        WorkQueue& queue = *_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest task from the other workers (FIFO)
+    for (size_t i = 1; i < _queues.size(); ++i) {
+        WorkQueue& queue = *_queues[(index + i) % _queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void ThreadPool::workerLoop(size_t index)
+{
+    tl_workerPool = this;
+    tl_workerIndex = index;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cv.wait(lock, [this]() { return _stop || _pending > 0; });
+
+            if (_stop)
+                break;
+        }
+
+        Task task;
+
+        if (popTask(index, task)) {
+            --_pending;
+            task();
+        }
+    }
+}
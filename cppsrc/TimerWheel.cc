@@ -0,0 +1,145 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "TimerWheel.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::Timer::cancel() noexcept
+{
+    if (!_wheel)
+        return;
+
+    unlink(*this);
+    --_wheel->_count;
+    _wheel = nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+TimerWheel::TimerWheel(Duration resolution)
+    : _resolution(resolution)
+    , _origin(Clock::now())
+{
+    for (auto& level : _slots) {
+        for (Link& slot : level)
+            slot.prev = slot.next = &slot;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+TimerWheel::~TimerWheel()
+{
+    for (auto& level : _slots) {
+        for (Link& slot : level) {
+            while (slot.next != &slot)
+                static_cast<Timer&>(*slot.next).cancel();
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::schedule(
+    Timer& timer, Duration timeout, TimePoint now) noexcept
+{
+    timer.cancel();
+
+    // Rounded up, so that the timer never expires early
+    const Duration elapsed = std::max(now - _origin + timeout, Duration(0));
+    const uint64_t expiry =
+        uint64_t((elapsed + _resolution - Duration(1)) / _resolution);
+
+    timer._expiry = std::max(expiry, _tick);
+    timer._wheel = this;
+    ++_count;
+
+    insert(timer);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::insert(Timer& timer) noexcept
+{
+    const uint64_t maxDelta = (uint64_t(1) << (LEVEL_BITS * LEVELS)) - 1;
+
+    // Beyond the range of the wheel, expiry is brought forward
+    uint64_t delta = timer._expiry - _tick;
+
+    if (delta > maxDelta) {
+        delta = maxDelta;
+        timer._expiry = _tick + delta;
+    }
+
+    int level = 0;
+
+    while (delta >> (LEVEL_BITS * (level + 1)))
+        ++level;
+
+    Link& slot = _slots[level][
+        (timer._expiry >> (LEVEL_BITS * level)) & (SLOTS - 1)];
+
+    // Append to the circular list of the slot
+    timer.prev = slot.prev;
+    timer.next = &slot;
+    slot.prev->next = &timer;
+    slot.prev = &timer;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::cascade(int level) noexcept
+{
+    Link pending;
+    splice(_slots[level][(_tick >> (LEVEL_BITS * level)) & (SLOTS - 1)],
+        pending);
+
+    while (pending.next != &pending) {
+        Timer& timer = static_cast<Timer&>(*pending.next);
+        unlink(timer);
+        insert(timer);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::unlink(Link& link) noexcept
+{
+    link.prev->next = link.next;
+    link.next->prev = link.prev;
+    link.prev = link.next = nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::splice(Link& from, Link& to) noexcept
+{
+    if (from.next == &from) {
+        to.prev = to.next = &to;
+        return;
+    }
+
+    to.next = from.next;
+    to.prev = from.prev;
+    to.next->prev = &to;
+    to.prev->next = &to;
+
+    from.prev = from.next = &from;
+}
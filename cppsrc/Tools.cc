@@ -11,6 +11,14 @@
 
 #include "Tools.h"
 
+#include <mutex>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -77,6 +85,28 @@ bool Tools::fileStat(
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+int64_t Tools::readFileAt(int fd, char* buf, size_t len, int64_t offset)
+{
+#ifdef WIN32
+    HANDLE handle = reinterpret_cast<HANDLE>(::_get_osfhandle(fd));
+    OVERLAPPED ov = { 0 };
+    ov.Offset = DWORD(offset);
+    ov.OffsetHigh = DWORD(offset >> 32);
+
+    DWORD size = 0;
+
+    if (!::ReadFile(handle, buf, DWORD(len), &size, &ov))
+        return ::GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+
+    return size;
+#else
+    return ::pread(fd, buf, len, off_t(offset));
+#endif
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 bool Tools::splitLineInTokens(const std::string& line,
@@ -106,3 +136,14 @@ bool Tools::splitLineInTokens(const std::string& line,
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+void Tools::writeLog(std::ostream& os, const std::string& text)
+{
+    static std::mutex mtx;
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    os.write(text.data(), std::streamsize(text.size()));
+    os.flush();
+}
@@ -12,8 +12,22 @@
 #include "Tools.h"
 #include "OsSocketSupport.h"
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <thread>
 
+#include <errno.h>
+#include <fcntl.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -26,19 +40,52 @@ TransportSocket::~TransportSocket()
 
 /* -------------------------------------------------------------------------- */
 
-TransportSocket::RecvEvent TransportSocket::waitForRecvEvent(
-    const TransportSocket::TimeoutInterval& timeout)
+int TransportSocket::waitForEvents(
+    short events, const TransportSocket::TimeoutInterval& timeout)
 {
-    struct timeval tv_timeout = { 0 };
-    Tools::convertDurationInTimeval(timeout, tv_timeout);
+    // poll() has no limit on the descriptor value, unlike select()
+    // whose fd_set cannot hold descriptors beyond FD_SETSIZE
+    pollfd pfd {};
+    pfd.fd = getSocketFd();
+    pfd.events = events;
+
+    using Msecs = std::chrono::milliseconds;
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (true) {
+        const auto left = std::max(
+            deadline - std::chrono::steady_clock::now(),
+            std::chrono::steady_clock::duration(0));
+
+        // Rounded up, so that a short timeout does not become a busy loop
+        const Msecs ms = std::chrono::duration_cast<Msecs>(
+            left + Msecs(1) - std::chrono::steady_clock::duration(1));
+
+#ifdef WIN32
+        int nd = ::WSAPoll(&pfd, 1, int(ms.count()));
+#else
+        int nd = ::poll(&pfd, 1, int(ms.count()));
+
+        if (nd < 0 && errno == EINTR)
+            continue;
+#endif
 
-    fd_set rd_mask;
+        if (nd <= 0)
+            return nd;
 
-    // Add socket to receive select mask
-    FD_ZERO(&rd_mask);
-    FD_SET(getSocketFd(), &rd_mask);
+        return (pfd.revents & POLLNVAL) ? -1 : pfd.revents;
+    }
+}
 
-    long nd = select(FD_SETSIZE, &rd_mask, (fd_set*)0, (fd_set*)0, &tv_timeout);
+
+/* -------------------------------------------------------------------------- */
+
+TransportSocket::RecvEvent TransportSocket::waitForRecvEvent(
+    const TransportSocket::TimeoutInterval& timeout)
+{
+    // A hang-up or an error are reported as readability, as select()
+    // does: the next recv() call returns them
+    int nd = waitForEvents(POLLIN, timeout);
 
     if (nd == 0)
         return RecvEvent::TIMEOUT;
@@ -51,46 +98,166 @@ TransportSocket::RecvEvent TransportSocket::waitForRecvEvent(
 
 /* -------------------------------------------------------------------------- */
 
-int TransportSocket::sendFile(const std::string& filepath) noexcept
+bool TransportSocket::waitForSendEvent(
+    const TransportSocket::TimeoutInterval& timeout)
 {
-    std::ifstream ifs(filepath.c_str(), std::ios::in | std::ios::binary);
+    return waitForEvents(POLLOUT, timeout) > 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int64_t TransportSocket::sendv(
+    const Buffer* buffers, int count, int flags) noexcept
+{
+    count = std::min(count, int(MAX_SEND_BUFFERS));
+
+#ifdef WIN32
+    WSABUF wsaBuf[MAX_SEND_BUFFERS];
+
+    for (int i = 0; i < count; ++i) {
+        wsaBuf[i].buf = const_cast<char*>(buffers[i].data);
+        wsaBuf[i].len = ULONG(buffers[i].size);
+    }
 
-    if (!ifs.is_open())
+    DWORD sent = 0;
+
+    if (::WSASend(getSocketFd(), wsaBuf, DWORD(count), &sent, DWORD(flags), 
+        nullptr, nullptr) != 0) 
+    {
         return -1;
+    }
 
-    std::unique_ptr<char[]> buffer(new char[TX_BUFFER_SIZE]);
+    return int64_t(sent);
+#else
+    struct iovec iov[MAX_SEND_BUFFERS];
+
+    for (int i = 0; i < count; ++i) {
+        iov[i].iov_base = const_cast<char*>(buffers[i].data);
+        iov[i].iov_len = buffers[i].size;
+    }
 
-    int sent_bytes = 0;
+    struct msghdr msg {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
 
-    while (ifs.good()) {
-        ifs.read(buffer.get(), sizeof(buffer));
+    return int64_t(::sendmsg(getSocketFd(), &msg, flags));
+#endif
+}
 
-        int size = static_cast<int>(ifs.gcount());
 
-        if (size > 0) {
-            int bsent = 0;
+/* -------------------------------------------------------------------------- */
 
-            // sent the whole buffer content
-            while (bsent < size) {
-                int txc = send(buffer.get(), size);
-                if (txc < 0)
-                    return -1;
+int64_t TransportSocket::sendFile(
+    int fd, int64_t offset, int64_t size) noexcept
+{
+    int64_t sent_bytes = 0;
 
-                if (txc == 0) { // tx queue is congested ?
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                    continue;
-                }
+#ifdef HTTP_SERVER_SENDFILE_SUPPORT
+    off_t pos = off_t(offset);
+    const off_t end = off_t(offset + size);
 
-                bsent += txc;
-            }
+    while (pos < end) {
+        ssize_t txc = sendFile(fd, pos, size_t(end - pos));
 
-            sent_bytes += bsent;
-        } 
-        else {
+        if (txc > 0 || (txc < 0 && errno == EINTR))
+            continue;
+
+        // tx queue is congested (non-blocking socket)
+        if (txc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (waitForSendEvent(_sendTimeout))
+                continue;
+        }
+        // sendfile is not supported for this file: read it instead
+        else if (txc < 0 && (errno == EINVAL || errno == ENOSYS) 
+            && pos == offset) 
+        {
+            break;
+        }
+
+        return -1;
+    }
+
+    if (pos >= end)
+        return size;
+#endif
+
+    // The buffer is allocated once per thread rather than per file
+    thread_local std::unique_ptr<char[]> buffer;
+
+    if (!buffer)
+        buffer.reset(new char[TX_BUFFER_SIZE]);
+
+    while (sent_bytes < size) {
+        int len = int(std::min(int64_t(TX_BUFFER_SIZE), size - sent_bytes));
+
+        // The descriptor may be shared, so its position is not used
+        len = int(Tools::readFileAt(
+            fd, buffer.get(), len, offset + sent_bytes));
+
+        if (len <= 0)
             return -1;
+
+        int bsent = 0;
+
+        // sent the whole buffer content
+        while (bsent < len) {
+            int txc = send(buffer.get() + bsent, len - bsent);
+            if (txc < 0)
+                return -1;
+
+            if (txc == 0) { // tx queue is congested ?
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                continue;
+            }
+
+            bsent += txc;
         }
+
+        sent_bytes += bsent;
     }
 
     return sent_bytes;
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+bool TransportSocket::setNonBlockingMode(bool on) noexcept
+{
+#ifdef WIN32
+    u_long mode = on ? 1 : 0;
+    return ::ioctlsocket(getSocketFd(), FIONBIO, &mode) == 0;
+#else
+    int flags = ::fcntl(getSocketFd(), F_GETFL, 0);
+
+    if (flags < 0)
+        return false;
+
+    flags = on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+
+    return ::fcntl(getSocketFd(), F_SETFL, flags) == 0;
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool TransportSocket::setSendTimeout(const TimeoutInterval& timeout) noexcept
+{
+    _sendTimeout = timeout;
+
+#ifdef WIN32
+    DWORD ms = DWORD(
+        std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+
+    return ::setsockopt(getSocketFd(), SOL_SOCKET, SO_SNDTIMEO, 
+        reinterpret_cast<const char*>(&ms), sizeof(ms)) == 0;
+#else
+    struct timeval tv {};
+    Tools::convertDurationInTimeval(timeout, tv);
+
+    return ::setsockopt(
+        getSocketFd(), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == 0;
+#endif
+}
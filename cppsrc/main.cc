@@ -9,6 +9,7 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "CharScanner.h"
 #include "HttpServer.h"
 #include "Tools.h"
 
@@ -23,13 +24,31 @@ private:
     std::string _prog_name;
     std::string _command_line;
     std::string _webRootPath = HTTP_SERVER_WROOT;
+    std::string _mimeTypesPath;
+    std::string _statsPath = HTTP_STATS_PATH;
+    std::string _accessLogPath;
+    AccessLog::Format _accessLogFormat = AccessLog::Format::COMBINED;
 
     TcpSocket::TranspPort _http_server_port = HTTP_SERVER_PORT;
+    size_t _threads = HTTP_SERVER_THREADS;
+    size_t _shards = HTTP_SERVER_LISTENER_SHARDS;
+    size_t _file_cache_entries = HTTP_FILE_CACHE_ENTRIES;
+    int _file_cache_ttl = HTTP_FILE_CACHE_TTL;
+    size_t _content_cache_size = HTTP_CONTENT_CACHE_SIZE;
+    size_t _content_cache_entry_size = HTTP_CONTENT_CACHE_ENTRY_SIZE;
+#ifdef HTTP_SERVER_ZLIB_SUPPORT
+    size_t _gzip_cache_size = HTTP_GZIP_CACHE_SIZE;
+#else
+    size_t _gzip_cache_size = 0;
+#endif
+    HttpTimeouts _timeouts;
     
     bool _show_help = false;
     bool _show_ver = false;
     bool _error = false;
     bool _verboseModeOn = false;
+    bool _reactorModeOn = false;
+    bool _ioUringOn = false;
     std::string _err_msg;
 
     static const int _min_ver = HTTP_SERVER_MIN_V;
@@ -51,6 +70,22 @@ public:
        return _webRootPath; 
     }
 
+    const std::string& getMimeTypesPath() const { 
+       return _mimeTypesPath; 
+    }
+
+    const std::string& getStatsPath() const { 
+       return _statsPath; 
+    }
+
+    const std::string& getAccessLogPath() const { 
+       return _accessLogPath; 
+    }
+
+    AccessLog::Format getAccessLogFormat() const { 
+       return _accessLogFormat; 
+    }
+
     TcpSocket::TranspPort get_http_server_port() const {
         return _http_server_port;
     }
@@ -64,6 +99,46 @@ public:
        return _verboseModeOn; 
     }
 
+    size_t get_threads() const {
+        return _threads;
+    }
+
+    size_t get_shards() const {
+        return _shards;
+    }
+
+    size_t get_file_cache_entries() const {
+        return _file_cache_entries;
+    }
+
+    int get_file_cache_ttl() const {
+        return _file_cache_ttl;
+    }
+
+    size_t get_content_cache_size() const {
+        return _content_cache_size;
+    }
+
+    size_t get_content_cache_entry_size() const {
+        return _content_cache_entry_size;
+    }
+
+    size_t get_gzip_cache_size() const {
+        return _gzip_cache_size;
+    }
+
+    const HttpTimeouts& get_timeouts() const {
+        return _timeouts;
+    }
+
+    bool reactorModeOn() const { 
+       return _reactorModeOn; 
+    }
+
+    bool ioUringOn() const { 
+       return _ioUringOn; 
+    }
+
     const std::string& error() const { 
        return _err_msg; 
     }
@@ -84,6 +159,60 @@ public:
         os << "\t\t-w | --webroot <working_dir_path>\n";
         os << "\t\t\tSet a local working directory (default is "
            << HTTP_SERVER_WROOT << ") \n";
+        os << "\t\t-m | --mime-types <file_path>\n";
+        os << "\t\t\tLoad additional MIME types from a mime.types file\n";
+        os << "\t\t-st | --stats-path <uri>\n";
+        os << "\t\t\tServe the server metrics at a path, e.g. /__stats\n";
+        os << "\t\t\t(disabled by default) \n";
+        os << "\t\t-l | --access-log <file_path>\n";
+        os << "\t\t\tAppend a line for each request to a file, \"-\" for\n";
+        os << "\t\t\tthe standard output\n";
+        os << "\t\t-lf | --access-log-format <common|combined|json>\n";
+        os << "\t\t\tSet the format of the access log (default is\n";
+        os << "\t\t\tcombined)\n";
+        os << "\t\t-t | --threads <count>\n";
+        os << "\t\t\tSet the number of worker threads (default is the\n";
+        os << "\t\t\tnumber of hardware threads)\n";
+        os << "\t\t-s | --shards <count>\n";
+        os << "\t\t\tSet the number of listening sockets sharing the port,\n";
+        os << "\t\t\teach with its own accept loop (default is "
+           << HTTP_SERVER_LISTENER_SHARDS << ", 0 means the\n";
+        os << "\t\t\tnumber of hardware threads)\n";
+        os << "\t\t-fc | --file-cache <entries>\n";
+        os << "\t\t\tSet the number of open files kept in cache (default is "
+           << HTTP_FILE_CACHE_ENTRIES << ", 0 disables the cache) \n";
+        os << "\t\t-ft | --file-cache-ttl <secs>\n";
+        os << "\t\t\tSet how long a cached file is used before checking it\n";
+        os << "\t\t\tagain (default is " << HTTP_FILE_CACHE_TTL << ") \n";
+        os << "\t\t-cc | --content-cache <KiB>\n";
+        os << "\t\t\tSet the memory used to cache file contents (default is "
+           << (HTTP_CONTENT_CACHE_SIZE >> 10) << ", 0 disables the cache) \n";
+        os << "\t\t-ce | --content-cache-entry <KiB>\n";
+        os << "\t\t\tSet the size of the largest file kept in memory\n";
+        os << "\t\t\t(default is " << (HTTP_CONTENT_CACHE_ENTRY_SIZE >> 10) 
+           << ") \n";
+        os << "\t\t-gz | --gzip-cache <KiB>\n";
+        os << "\t\t\tSet the memory used to cache text files compressed\n";
+        os << "\t\t\ton the fly (default is "
+           << (HTTP_GZIP_CACHE_SIZE >> 10) << ", 0 disables the compression)\n";
+        os << "\t\t-ti | --idle-timeout <secs>\n";
+        os << "\t\t\tSet how long a keep-alive connection may wait for\n";
+        os << "\t\t\ta new request (default is " << HTTP_IDLE_TIMEOUT 
+           << ") \n";
+        os << "\t\t-th | --header-timeout <secs>\n";
+        os << "\t\t\tSet how long a client may take to send a request\n";
+        os << "\t\t\theader (default is " << HTTP_HEADER_TIMEOUT << ") \n";
+        os << "\t\t-ts | --send-timeout <secs>\n";
+        os << "\t\t\tSet how long a client may take to accept any byte\n";
+        os << "\t\t\tof a response (default is " << HTTP_SEND_TIMEOUT 
+           << ") \n";
+        os << "\t\t-r | --reactor\n";
+        os << "\t\t\tServe all connections from a single event loop\n";
+        os << "\t\t\tinstead of handing their requests over to the\n";
+        os << "\t\t\tpool of worker threads\n";
+        os << "\t\t-u | --io-uring\n";
+        os << "\t\t\tUse io_uring rather than epoll in reactor mode\n";
+        os << "\t\t\t(implies --reactor, requires Linux 6.0 or later)\n";
         os << "\t\t-vv | --verbose\n";
         os << "\t\t\tEnable logging on stderr\n";
         os << "\t\t-v | --version\n";
@@ -110,7 +239,12 @@ public:
         if (argc <= 1)
             return;
 
-        enum class State { OPTION, PORT, WEBROOT } state = State::OPTION;
+        enum class State { 
+            OPTION, PORT, WEBROOT, MIME_TYPES, STATS_PATH, ACCESS_LOG, 
+            ACCESS_LOG_FORMAT, THREADS, SHARDS, FILE_CACHE, FILE_CACHE_TTL,
+            CONTENT_CACHE, CONTENT_CACHE_ENTRY, GZIP_CACHE,
+            IDLE_TIMEOUT, HEADER_TIMEOUT, SEND_TIMEOUT
+        } state = State::OPTION;
 
         for (int idx = 1; idx < argc; ++idx) {
             std::string sarg = argv[idx];
@@ -130,6 +264,41 @@ public:
                 } else if (sarg == "--version" || sarg == "-v") {
                     _show_ver = true;
                     state = State::OPTION;
+                } else if (sarg == "--mime-types" || sarg == "-m") {
+                    state = State::MIME_TYPES;
+                } else if (sarg == "--stats-path" || sarg == "-st") {
+                    state = State::STATS_PATH;
+                } else if (sarg == "--access-log" || sarg == "-l") {
+                    state = State::ACCESS_LOG;
+                } else if (sarg == "--access-log-format" || sarg == "-lf") {
+                    state = State::ACCESS_LOG_FORMAT;
+                } else if (sarg == "--threads" || sarg == "-t") {
+                    state = State::THREADS;
+                } else if (sarg == "--shards" || sarg == "-s") {
+                    state = State::SHARDS;
+                } else if (sarg == "--file-cache" || sarg == "-fc") {
+                    state = State::FILE_CACHE;
+                } else if (sarg == "--file-cache-ttl" || sarg == "-ft") {
+                    state = State::FILE_CACHE_TTL;
+                } else if (sarg == "--content-cache" || sarg == "-cc") {
+                    state = State::CONTENT_CACHE;
+                } else if (sarg == "--content-cache-entry" || sarg == "-ce") {
+                    state = State::CONTENT_CACHE_ENTRY;
+                } else if (sarg == "--gzip-cache" || sarg == "-gz") {
+                    state = State::GZIP_CACHE;
+                } else if (sarg == "--idle-timeout" || sarg == "-ti") {
+                    state = State::IDLE_TIMEOUT;
+                } else if (sarg == "--header-timeout" || sarg == "-th") {
+                    state = State::HEADER_TIMEOUT;
+                } else if (sarg == "--send-timeout" || sarg == "-ts") {
+                    state = State::SEND_TIMEOUT;
+                } else if (sarg == "--reactor" || sarg == "-r") {
+                    _reactorModeOn = true;
+                    state = State::OPTION;
+                } else if (sarg == "--io-uring" || sarg == "-u") {
+                    _reactorModeOn = true;
+                    _ioUringOn = true;
+                    state = State::OPTION;
                 } else if (sarg == "--verbose" || sarg == "-vv") {
                     _verboseModeOn = true;
                     state = State::OPTION;
@@ -146,10 +315,85 @@ public:
                 state = State::OPTION;
                 break;
 
+            case State::MIME_TYPES:
+                _mimeTypesPath = sarg;
+                state = State::OPTION;
+                break;
+
+            case State::STATS_PATH:
+                _statsPath = sarg;
+                state = State::OPTION;
+                break;
+
+            case State::ACCESS_LOG:
+                _accessLogPath = sarg;
+                state = State::OPTION;
+                break;
+
+            case State::ACCESS_LOG_FORMAT:
+                if (!AccessLog::parseFormat(sarg, _accessLogFormat)) {
+                    _err_msg = "Unknown access log format '" + sarg
+                        + "', try with --help or -h";
+                    _error = true;
+                    return;
+                }
+                state = State::OPTION;
+                break;
+
             case State::PORT:
                 _http_server_port = std::stoi(sarg);
                 state = State::OPTION;
                 break;
+
+            case State::THREADS:
+                _threads = std::stoi(sarg);
+                state = State::OPTION;
+                break;
+
+            case State::SHARDS:
+                _shards = std::stoi(sarg);
+                state = State::OPTION;
+                break;
+
+            case State::FILE_CACHE:
+                _file_cache_entries = std::stoi(sarg);
+                state = State::OPTION;
+                break;
+
+            case State::FILE_CACHE_TTL:
+                _file_cache_ttl = std::stoi(sarg);
+                state = State::OPTION;
+                break;
+
+            case State::CONTENT_CACHE:
+                _content_cache_size = size_t(std::stoul(sarg)) << 10;
+                state = State::OPTION;
+                break;
+
+            case State::CONTENT_CACHE_ENTRY:
+                _content_cache_entry_size = size_t(std::stoul(sarg)) << 10;
+                state = State::OPTION;
+                break;
+
+            case State::GZIP_CACHE:
+                _gzip_cache_size = size_t(std::stoul(sarg)) << 10;
+                state = State::OPTION;
+                break;
+
+            case State::IDLE_TIMEOUT:
+                _timeouts.idle = std::chrono::seconds(std::stoi(sarg));
+                state = State::OPTION;
+                break;
+
+            case State::HEADER_TIMEOUT:
+                _timeouts.header = std::chrono::seconds(std::stoi(sarg));
+                state = State::OPTION;
+                break;
+
+            case State::SEND_TIMEOUT:
+                _timeouts.send = std::chrono::seconds(std::stoi(sarg));
+                state = State::OPTION;
+                break;
             }
         }
     }
@@ -190,6 +434,50 @@ int main(int argc, char* argv[])
     HttpServer& httpsrv = HttpServer::getInstance();
 
     httpsrv.setupWebRootPath(args.getWebRootPath());
+    httpsrv.setupThreadPoolSize(args.get_threads());
+    httpsrv.setupTimeouts(args.get_timeouts());
+
+    if (!args.getMimeTypesPath().empty() 
+        && !httpsrv.setupMimeTypes(args.getMimeTypesPath())) 
+    {
+        std::cerr << "Error loading MIME types from '" 
+                  << args.getMimeTypesPath() << "'\n";
+        return 1;
+    }
+    httpsrv.setupStats(args.getStatsPath());
+
+    if (!args.getAccessLogPath().empty()
+        && !httpsrv.setupAccessLog(
+            args.getAccessLogPath(), args.getAccessLogFormat()))
+    {
+        std::cerr << "Error opening access log '" 
+                  << args.getAccessLogPath() << "'\n";
+        return 1;
+    }
+
+    httpsrv.setupFileCache(args.get_file_cache_entries(), args.get_file_cache_ttl());
+    httpsrv.setupContentCache(
+        args.get_content_cache_size(), args.get_content_cache_entry_size());
+
+    if (!httpsrv.setupGzipCache(args.get_gzip_cache_size())) {
+        std::cerr << "gzip compression is not supported by this build\n";
+        return 1;
+    }
+
+    if (!httpsrv.setupReactorMode(args.reactorModeOn())) {
+        std::cerr << "Reactor mode is not supported on this platform\n";
+        return 1;
+    }
+
+    if (!httpsrv.setupIoUring(args.ioUringOn())) {
+        std::cerr << "io_uring is not supported on this system, "
+                     "using epoll\n";
+    }
+
+    if (!httpsrv.setupListenerShards(args.get_shards())) {
+        std::cerr << "Multiple listeners are not supported on this platform\n";
+        return 1;
+    }
 
     bool res = httpsrv.bind(args.get_http_server_port());
 
@@ -209,9 +497,15 @@ int main(int argc, char* argv[])
               << "Command line :'" << args.get_command_line() << "'"
               << std::endl
               << HTTP_SERVER_NAME << " is listening on TCP port "
-              << args.get_http_server_port() << std::endl
+              << args.get_http_server_port() << " ("
+              << httpsrv.getListenerShards() << " listener(s))" << std::endl
               << "Working directory is '" << args.getWebRootPath() << "'\n";
 
+    if (args.verboseModeOn()) {
+        std::cout << "Request headers are scanned by the "
+                  << CharScanner::getKernelName() << " kernel" << std::endl;
+    }
+
     httpsrv.setupLogger(args.verboseModeOn() ? &std::clog : nullptr);
 
     if (!httpsrv.run()) {
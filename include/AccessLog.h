@@ -0,0 +1,137 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file AccessLog.h
+///\brief Asynchronous access log
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __ACCESS_LOG_H__
+#define __ACCESS_LOG_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "TcpSocket.h"
+#include "config.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Writes a line for each request served, in Common Log Format, in
+ * Combined Log Format or as a JSON object.
+ * The threads serving the requests do not format nor write anything:
+ * each of them copies a fixed-size record of the request into a ring
+ * of its own, which a background thread drains, formatting and writing
+ * the records in batches. A ring has a single producer and a single
+ * consumer, so neither side takes locks. When a ring is full, because
+ * the log cannot keep up, the record is dropped and counted in the
+ * metrics (@see HttpStats).
+ */
+class AccessLog {
+public:
+    enum class Format { COMMON, COMBINED, JSON };
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+
+    /**
+     * Gets AccessLog object instance reference, shared by all
+     * the threads.
+     *
+     * @return the AccessLog reference
+     */
+    static auto getInstance() -> AccessLog&;
+
+
+    /**
+     * Opens the log and starts the thread writing it. It must be
+     * called before the server runs.
+     *
+     * @param fileName the path of the file the lines are appended
+     *                 to, "-" for the standard output
+     * @param format the format of the lines
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool open(const std::string& fileName, Format format);
+
+
+    /**
+     * Parses the name of a format ("common", "combined" or "json").
+     *
+     * @param name the name
+     * @param format the format
+     * @return true if the name is valid, false otherwise
+     */
+    static bool parseFormat(const std::string& name, Format& format);
+
+
+    /**
+     * Logs a request, if the log is open.
+     *
+     * @param socket the connection the request has been received from
+     * @param request the request
+     * @param response the response to the request
+     */
+    static void write(
+        const TcpSocket& socket,
+        const HttpRequest& request,
+        const HttpResponse& response) noexcept;
+
+private:
+    struct Record;
+    struct Ring;
+
+    FILE* _file = nullptr;
+    Format _format = Format::COMBINED;
+
+    std::mutex _mtx;
+    std::condition_variable _cond;
+    std::vector<Ring*> _rings;
+    std::thread _writer;
+    bool _stop = false;
+
+    AccessLog() = default;
+    ~AccessLog();
+
+    // Returns the ring of the calling thread
+    static Ring& getThreadRing();
+
+    // Makes the ring of a thread visible to the writer
+    void attach(Ring* ring);
+
+    // Drains the rings and writes the log until stopped
+    void run();
+
+    // Formats the records of a ring, returns false if the ring has
+    // been released by its thread and is now empty
+    bool drain(Ring& ring, std::string& output);
+
+    // Appends the line of a record to the output
+    void format(const Record& record, std::string& output) const;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __ACCESS_LOG_H__
@@ -0,0 +1,86 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file Arena.h
+///\brief Bump allocator releasing its memory all at once
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#include <cstddef>
+#include <memory_resource>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Memory resource handing out memory from fixed-size blocks by just
+ * advancing a pointer. Deallocation is a no-op: the memory is released
+ * all at once by reset(), when the objects it backs (e.g. the responses
+ * of a connection) are no longer in use.
+ * Blocks are taken from a pool owned by the calling thread and given
+ * back to it when the arena is destroyed, so that connections reuse
+ * the blocks of the closed ones without involving malloc or locks.
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+
+    /**
+     * Releases all the memory allocated so far. The first block is
+     * kept for later allocations, the other ones go back to the pool.
+     */
+    void reset() noexcept;
+
+private:
+    // Header of a block, followed by the memory handed out
+    struct alignas(std::max_align_t) Block {
+        Block* next;
+        size_t size; // including the header
+    };
+
+    Block* _blocks = nullptr; // most recently acquired first
+    char* _cursor = nullptr;
+    char* _end = nullptr;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    // Makes room for at least the given number of bytes
+    void grow(size_t bytes);
+
+    // Gives a block back to the pool, or to the heap
+    static void release(Block* block) noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __ARENA_H__
@@ -0,0 +1,95 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file CharScanner.h
+///\brief Vectorized search of delimiters within request headers
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __CHAR_SCANNER_H__
+#define __CHAR_SCANNER_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#include <cstddef>
+#include <string_view>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Locates the delimiters of a request header (CR/LF, ':', ' ')
+ * comparing 16 or 32 bytes at a time, by means of SSE2 or AVX2
+ * instructions. The widest kernel supported by the processor is
+ * selected at startup, falling back to a byte-at-a-time search on
+ * other processors.
+ */
+class CharScanner {
+public:
+    static constexpr size_t npos = std::string_view::npos;
+
+    CharScanner() = delete;
+
+
+    /**
+     * Returns the position of the first character equal to either
+     * of two characters.
+     *
+     * @param s    The string to search
+     * @param c1   A character to search for
+     * @param c2   Another character to search for
+     * @param from The position to start the search at
+     * @return the position of the character, or npos if not found
+     */
+    static size_t find(
+        std::string_view s, char c1, char c2, size_t from = 0) noexcept;
+
+
+    /**
+     * Returns the position of the first occurrence of a character.
+     *
+     * @param s    The string to search
+     * @param c    The character to search for
+     * @param from The position to start the search at
+     * @return the position of the character, or npos if not found
+     */
+    static size_t find(std::string_view s, char c, size_t from = 0) noexcept {
+        return find(s, c, c, from);
+    }
+
+
+    /**
+     * Returns the position of the empty line ending a request header,
+     * i.e. of the CRLF CRLF sequence.
+     *
+     * @param s    The received data
+     * @param from The position to start the search at; the sequence
+     *             may start before it if it spans more reads, so it
+     *             is safe to pass the size of the data already searched
+     * @return the position of the sequence, or npos if not found
+     */
+    static size_t findHeaderEnd(std::string_view s, size_t from = 0) noexcept;
+
+
+    /**
+     * Returns the name of the kernel in use ("avx2", "sse2", "scalar").
+     */
+    static const char* getKernelName() noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __CHAR_SCANNER_H__
@@ -0,0 +1,104 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file ContentCache.h
+///\brief In-memory cache of small file contents
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __CONTENT_CACHE_H__
+#define __CONTENT_CACHE_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "FileCache.h"
+#include "config.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Keeps the content of small, frequently requested files in memory,
+ * within a global byte budget. When the budget is exceeded the least
+ * recently used contents are evicted.
+ * A cached content is discarded as soon as the file it was read from
+ * is found to have a different modification time or size.
+ */
+class ContentCache {
+public:
+    using Content = std::shared_ptr<const std::string>;
+
+    ContentCache(const ContentCache&) = delete;
+    ContentCache& operator=(const ContentCache&) = delete;
+
+
+    /**
+     * Gets ContentCache object instance reference, shared by all
+     * the connections.
+     *
+     * @return the ContentCache reference
+     */
+    static auto getInstance() -> ContentCache&;
+
+
+    /**
+     * Configures the cache.
+     *
+     * @param budget maximum number of bytes kept in cache,
+     *               zero disables the cache
+     * @param maxEntrySize size in bytes of the largest file cached
+     */
+    void setup(size_t budget, size_t maxEntrySize);
+
+
+    /**
+     * Returns the content of a file, reading it if not cached yet
+     * or if the file has changed since it was cached.
+     *
+     * @param fileEntry the open file
+     * @return the handle to the file content, or an empty handle if
+     *         the file is too large to be cached or cannot be read
+     */
+    Content get(const FileCache::Entry& fileEntry);
+
+private:
+    struct Node {
+        Content content;
+        time_t modTime = 0;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    std::mutex _mtx;
+    std::unordered_map<std::string, Node> _nodes;
+    std::list<std::string> _lru; // most recently used first
+
+    size_t _budget = 0;
+    size_t _maxEntrySize = 0;
+    size_t _usedBytes = 0;
+
+    ContentCache();
+
+    static Content read(const FileCache::Entry& fileEntry);
+    void erase(std::unordered_map<std::string, Node>::iterator it);
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __CONTENT_CACHE_H__
@@ -0,0 +1,130 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file EventPoller.h
+///\brief Readiness notification facility (Linux epoll)
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __EVENT_POLLER_H__
+#define __EVENT_POLLER_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include "TransportSocket.h"
+
+#include <sys/epoll.h>
+
+#include <memory>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Monitors multiple socket descriptors to see if I/O is possible
+ * on any of them
+ */
+class EventPoller {
+public:
+    using Handle = std::unique_ptr<EventPoller>;
+    using SocketFd = TransportSocket::SocketFd;
+    using TimeoutInterval = TransportSocket::TimeoutInterval;
+    using Event = epoll_event;
+
+    EventPoller(const EventPoller&) = delete;
+    EventPoller& operator=(const EventPoller&) = delete;
+    ~EventPoller();
+
+
+    /**
+     * Returns a handle to a new poller object.
+     *
+     * @return the handle to a new poller object instance
+     */
+    static Handle create() {
+        return Handle(new EventPoller());
+    }
+
+
+    /**
+     * Returns true if poller is valid, false otherwise.
+     */
+    bool isValid() const noexcept {
+        return _epollFd >= 0;
+    }
+
+
+    /**
+     * Registers a socket descriptor.
+     *
+     * @param sd socket descriptor to monitor
+     * @param events epoll event mask (EPOLLIN, EPOLLOUT, EPOLLET, ...)
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool add(const SocketFd& sd, uint32_t events) noexcept {
+        return control(EPOLL_CTL_ADD, sd, events);
+    }
+
+
+    /**
+     * Changes the event mask of a registered socket descriptor.
+     *
+     * @param sd socket descriptor
+     * @param events new epoll event mask
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool modify(const SocketFd& sd, uint32_t events) noexcept {
+        return control(EPOLL_CTL_MOD, sd, events);
+    }
+
+
+    /**
+     * Deregisters a socket descriptor.
+     *
+     * @param sd socket descriptor
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool remove(const SocketFd& sd) noexcept {
+        return control(EPOLL_CTL_DEL, sd, 0);
+    }
+
+
+    /**
+     * Waits for events on the registered socket descriptors.
+     *
+     * @param events The vector filled with the ready events; its size
+     *               is the maximum number of events returned
+     * @param timeout The time-out value
+     * @return the number of ready events, zero if time limit expired,
+     *         -1 if an error occurred
+     */
+    int wait(std::vector<Event>& events, const TimeoutInterval& timeout);
+
+private:
+    int _epollFd = -1;
+
+    EventPoller();
+    bool control(int op, const SocketFd& sd, uint32_t events) noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
+
+#endif // __EVENT_POLLER_H__
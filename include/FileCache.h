@@ -0,0 +1,204 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file FileCache.h
+///\brief Cache of open file descriptors and file attributes
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __FILE_CACHE_H__
+#define __FILE_CACHE_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Keeps the files requested to the server open, together with
+ * their attributes, so that the same file served to many
+ * connections costs neither a stat() nor an open() per request.
+ * Attributes and content are read from the same descriptor, so
+ * they cannot refer to different versions of a file.
+ * The response header of each file is also rendered once, when
+ * the file is opened.
+ * Entries are refreshed once their time-to-live is elapsed.
+ */
+class FileCache {
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /**
+     * A regular file open for reading and its attributes
+     */
+    class Entry {
+        friend class FileCache;
+
+    public:
+        using Handle = std::shared_ptr<const Entry>;
+
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry();
+
+        /**
+         * Returns the file path
+         */
+        const std::string& getPath() const noexcept {
+            return _path;
+        }
+
+        /**
+         * Returns the file descriptor, it must be read by using
+         * positional reads only since it is shared
+         */
+        int getFd() const noexcept {
+            return _fd;
+        }
+
+        /**
+         * Returns the file size in bytes
+         */
+        int64_t getSize() const noexcept {
+            return _size;
+        }
+
+        /**
+         * Returns the time of last modification of file
+         */
+        time_t getModTime() const noexcept {
+            return _modTime;
+        }
+
+        /**
+         * Returns the weak entity tag of the file, derived from its
+         * inode, size and time of last modification, e.g. W/"1f-2a-5e"
+         */
+        const std::string& getETag() const noexcept {
+            return _etag;
+        }
+
+        /**
+         * Returns the file extension, or "." if there is no any
+         */
+        const std::string& getExt() const noexcept {
+            return _ext;
+        }
+
+        /**
+         * Returns the pre-rendered response header for the file
+         * (@see HttpResponse::formatFileHeader())
+         */
+        const std::string& getHeader() const noexcept {
+            return _header;
+        }
+
+        /**
+         * Returns the pre-rendered response header for the file served
+         * as the precompressed variant of another one, e.g. "foo.js.gz"
+         * in place of "foo.js", or an empty string if the file is not
+         * such a variant (@see HttpResponse::formatEncodedHeader())
+         */
+        const std::string& getEncodedHeader() const noexcept {
+            return _encodedHeader;
+        }
+
+    private:
+        std::string _path;
+        int _fd = -1;
+        int64_t _size = 0;
+        time_t _modTime = 0;
+        std::string _ext;
+        std::string _etag;
+        std::string _header;
+        std::string _encodedHeader;
+        TimePoint _expiry;
+
+        Entry() = default;
+    };
+
+
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+
+    /**
+     * Gets FileCache object instance reference, shared by all
+     * the connections.
+     *
+     * @return the FileCache reference
+     */
+    static auto getInstance() -> FileCache&;
+
+
+    /**
+     * Configures the cache.
+     *
+     * @param maxEntries maximum number of open files kept in cache,
+     *                   zero disables the cache
+     * @param ttl time an entry is considered valid, in seconds
+     */
+    void setup(size_t maxEntries, int ttl);
+
+
+    /**
+     * Returns the entry of the regular file path, opening it
+     * if not cached yet or if the cached entry is expired.
+     *
+     * @param path String containing the path of the file
+     * @param cacheMissing true to remember a missing file as well,
+     *        until the time-to-live elapses, so that probing for an
+     *        optional file (e.g. a precompressed variant) costs no
+     *        system call per request
+     * @return the handle to the file entry, or an empty handle if
+     *         the file is not a readable regular file
+     */
+    Entry::Handle get(std::string_view path, bool cacheMissing = false);
+
+private:
+    enum { SHARDS = 16 };
+
+    // Entries are spread over several independently locked maps
+    // so that concurrent connections seldom contend the same lock
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, Entry::Handle> entries;
+    };
+
+    Shard _shards[SHARDS];
+    size_t _maxShardEntries = 0;
+    std::chrono::seconds _ttl;
+
+    FileCache();
+
+    static Entry::Handle open(const std::string& fileName, const TimePoint& expiry);
+
+    // Makes room for a new entry
+    void evict(Shard& shard, const TimePoint& now);
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __FILE_CACHE_H__
@@ -0,0 +1,146 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file GzipCache.h
+///\brief In-memory cache of gzip compressed file contents
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __GZIP_CACHE_H__
+#define __GZIP_CACHE_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#ifdef HTTP_SERVER_ZLIB_SUPPORT
+
+#include "ContentCache.h"
+#include "FileCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Keeps gzip compressed copies of text files, within a global byte
+ * budget, evicting the least recently used ones when it is exceeded.
+ * Files are compressed by a background thread: the first request
+ * for a file queues its compression and is answered uncompressed,
+ * so that the I/O threads never wait for the compressor.
+ * A compressed copy is discarded as soon as the file it was made of
+ * is found to have a different modification time or size.
+ */
+class GzipCache {
+public:
+    /**
+     * A compressed copy of a file
+     */
+    struct Variant {
+        ContentCache::Content content;
+        std::string etag;   // distinct from the one of the file
+        std::string header; // @see HttpResponse::formatFileHeader()
+    };
+
+    using Handle = std::shared_ptr<const Variant>;
+
+    GzipCache(const GzipCache&) = delete;
+    GzipCache& operator=(const GzipCache&) = delete;
+    ~GzipCache();
+
+
+    /**
+     * Gets GzipCache object instance reference, shared by all
+     * the connections.
+     *
+     * @return the GzipCache reference
+     */
+    static auto getInstance() -> GzipCache&;
+
+
+    /**
+     * Configures the cache.
+     *
+     * @param budget maximum number of compressed bytes kept in cache,
+     *               zero disables the compression
+     */
+    void setup(size_t budget);
+
+
+    /**
+     * Returns true if a file is worth compressing, according to its
+     * MIME type and size.
+     *
+     * @param fileEntry the open file
+     */
+    static bool isCompressible(const FileCache::Entry& fileEntry);
+
+
+    /**
+     * Returns the compressed copy of a file. If it is not available
+     * yet, the compression of the file is queued.
+     *
+     * @param fileEntry the open file
+     * @return the handle to the compressed copy, or an empty handle
+     *         if it is not available or the file does not compress
+     */
+    Handle get(const FileCache::Entry::Handle& fileEntry);
+
+private:
+    enum { MAX_PENDING = 64 };
+
+    struct Node {
+        Handle variant; // empty if compressing the file failed or was useless
+        time_t modTime = 0;
+        int64_t size = 0;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    std::mutex _mtx;
+    std::condition_variable _cond;
+    std::unordered_map<std::string, Node> _nodes;
+    std::list<std::string> _lru; // most recently used first
+
+    std::deque<FileCache::Entry::Handle> _pending;
+    std::unordered_set<std::string> _pendingPaths;
+    std::thread _worker;
+    bool _stop = false;
+
+    size_t _budget = 0;
+    size_t _usedBytes = 0;
+
+    GzipCache();
+
+    // Compresses the queued files, it runs in the worker thread
+    void run();
+
+    static Handle compress(const FileCache::Entry& fileEntry);
+    void insert(const FileCache::Entry& fileEntry, Handle variant);
+    void erase(std::unordered_map<std::string, Node>::iterator it);
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_ZLIB_SUPPORT
+
+#endif // __GZIP_CACHE_H__
@@ -0,0 +1,107 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpClock.h
+///\brief Process-wide source of HTTP formatted dates
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_CLOCK_H__
+#define __HTTP_CLOCK_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Provides the current date formatted as IMF-fixdate (RFC 7231),
+ * e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+ * The date is formatted once per second by the first thread that
+ * notices the second has changed, and published to the other threads
+ * without locks.
+ */
+class HttpClock {
+public:
+    enum { DATE_SIZE = 29 }; // length of an IMF-fixdate string
+
+    HttpClock() = delete;
+
+
+    /**
+     * Copies the current date into a buffer.
+     *
+     * @param date The buffer receiving the date, at least DATE_SIZE + 1
+     *             characters long; the date is null-terminated
+     */
+    static void getDate(char* date) noexcept;
+
+
+    /**
+     * Returns the current date.
+     */
+    static std::string getDate() {
+        char date[DATE_SIZE + 1];
+        getDate(date);
+        return std::string(date, DATE_SIZE);
+    }
+
+
+    /**
+     * Formats a time as IMF-fixdate.
+     *
+     * @param t The time to format
+     * @param date The buffer receiving the date, at least DATE_SIZE + 1
+     *             characters long; the date is null-terminated
+     */
+    static void formatDate(time_t t, char* date) noexcept;
+
+
+    /**
+     * Parses a date formatted as IMF-fixdate.
+     *
+     * @param date The input string
+     * @param t The parsed time
+     * @return true if the date is well-formed, false otherwise
+     */
+    static bool parseDate(std::string_view date, time_t& t) noexcept;
+
+private:
+    enum { SLOTS = 4, SLOT_WORDS = (DATE_SIZE + 1 + 7) / 8 };
+
+    // The date of a second is written in the slot of the second, which
+    // is not the published one (unless a writer is SLOTS seconds late).
+    // The sequence number is odd while the slot is being written,
+    // so a reader can detect and retry a torn copy (seqlock).
+    struct Slot {
+        std::atomic<unsigned> seq;
+        std::atomic<uint64_t> words[SLOT_WORDS];
+    };
+
+    static Slot _slots[SLOTS];
+    static std::atomic<time_t> _currentSecond;   // being formatted
+    static std::atomic<time_t> _publishedSecond; // readable
+
+    static void update(time_t now) noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __HTTP_CLOCK_H__
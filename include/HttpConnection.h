@@ -0,0 +1,265 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpConnection.h
+///\brief Non-blocking HTTP connection driven by I/O events
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_CONNECTION_H__
+#define __HTTP_CONNECTION_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include "Arena.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseQueue.h"
+#include "HttpStats.h"
+#include "HttpTimeouts.h"
+#include "TcpSocket.h"
+#include "TimerWheel.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * This class represents an HTTP connection handled by the reactor.
+ * The connection is a state machine that never blocks: it consumes
+ * whatever the socket can provide or accept and then returns the
+ * control to the event loop, which resumes it on the next event.
+ * The connection can be driven either by readiness events, in which
+ * case it performs its own I/O, or by a completion based backend,
+ * which reads and writes on its behalf.
+ */
+class HttpConnection {
+public:
+    using Handle = std::shared_ptr<HttpConnection>;
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    enum class State {
+        IDLE,           // keep-alive, waiting for a new request
+        READING_HEADER, // a partial request header has been received
+        SENDING_HEADER, // queued response headers are being transmitted
+        SENDING_BODY,   // the response body is being transmitted
+        CLOSED          // connection must be released
+    };
+
+    HttpConnection(const HttpConnection&) = delete;
+    HttpConnection& operator=(const HttpConnection&) = delete;
+
+
+    /**
+     * Returns a handle to a new connection object.
+     *
+     * @param socketHandle non-blocking connected tcp socket
+     * @param webRootPath local working directory of the web server
+     * @param verboseModeOn true to dump requests and responses on logger
+     * @param logger output stream used for logging
+     * @return the handle to a new connection object instance
+     */
+    static Handle create(
+        TcpSocket::Handle socketHandle,
+        const std::string& webRootPath,
+        bool verboseModeOn,
+        std::ostream& logger)
+    {
+        return Handle(new HttpConnection(
+            socketHandle, webRootPath, verboseModeOn, logger));
+    }
+
+
+    /**
+     * Handles a readability event: drains the socket and serves any
+     * complete request found in the input buffer.
+     */
+    void onRecvEvent();
+
+
+    /**
+     * Handles a writability event: resumes a pending transmission.
+     */
+    void onSendEvent();
+
+
+    /**
+     * Handles data received by a completion based backend.
+     * The data is appended to the input buffer; it is processed by
+     * the next call to advance().
+     *
+     * @param data The received data
+     * @param size The size in bytes of the data
+     */
+    void onRecvData(const char* data, size_t size);
+
+
+    /**
+     * Notifies that the remote peer has finished sending: the
+     * connection is closed once the pending responses have been sent.
+     */
+    void onRecvClosed() noexcept {
+        _peerClosed = true;
+    }
+
+
+    /**
+     * Advances a connection driven by a completion based backend:
+     * transmits the file body in progress, if any, and processes the
+     * buffered requests, queueing their responses.
+     * When the file body cannot be completed without blocking, the 
+     * connection is left in SENDING_BODY state and advance() has to 
+     * be called again once the socket is writable.
+     *
+     * @param buffers The array receiving the buffers of the queued
+     *                responses, to be sent by a gathered write
+     * @param maxCount The size of the array
+     * @return the number of buffers filled in, zero if there is 
+     *         nothing to write
+     */
+    int advance(TransportSocket::Buffer* buffers, int maxCount);
+
+
+    /**
+     * Notifies the completion of a gathered write of queued responses
+     * (@see advance()).
+     *
+     * @param bytes The number of bytes sent
+     */
+    void onSent(size_t bytes);
+
+
+    /**
+     * Returns the flags for the next write of queued responses: their
+     * transmission is corked if a file body follows.
+     */
+    int getSendFlags() const noexcept {
+        return MSG_NOSIGNAL | (_bodyFile ? TcpSocket::SEND_MORE : 0);
+    }
+
+
+    /**
+     * Forces the connection into closed state.
+     */
+    void close() noexcept {
+        _state = State::CLOSED;
+    }
+
+
+    /**
+     * Returns the current state of the connection
+     */
+    State getState() const noexcept {
+        return _state;
+    }
+
+
+    /**
+     * Schedules the timer of the connection for the time limit of
+     * its current state, unless already scheduled for it. While a
+     * response is being sent, the limit is postponed by any progress.
+     * The context of the timer is the connection.
+     * It is called after each event, so it also reports to the metrics
+     * whether the connection is idle.
+     *
+     * @param timers The wheel of the event loop
+     * @param timeouts The time limits
+     */
+    void updateTimer(TimerWheel& timers, const HttpTimeouts& timeouts);
+
+
+    /**
+     * Returns the socket descriptor of the connection
+     */
+    const TcpSocket::SocketFd& getSocketFd() const noexcept {
+        return _socketHandle->getSocketFd();
+    }
+
+private:
+    TcpSocket::Handle _socketHandle;
+    std::string _webRootPath;
+    bool _verboseModeOn = false;
+    std::ostream& _logger;
+
+    State _state = State::IDLE;
+    TimePoint _lastActivity = std::chrono::steady_clock::now();
+
+    uint64_t _requestCount = 0;
+    HttpStats::Connection _stats;
+
+    // The timer is set for a state, an activity time and a request
+    TimerWheel::Timer _timer { this };
+    State _timerState = State::CLOSED;
+    TimePoint _timerActivity;
+    uint64_t _timerRequestCount = 0;
+
+    bool _recvPending = false;
+    bool _peerClosed = false;
+
+    std::string _rxBuffer;
+    HttpResponseQueue _txQueue;
+    Arena _arena; // backs the queued responses, reset once sent
+
+    FileCache::Entry::Handle _bodyFile;
+    off_t _bodyOffset = 0;
+    off_t _bodyEnd = 0;
+    TimePoint _bodyRequestTime; // the request the body answers
+
+    HttpConnection(
+        TcpSocket::Handle socketHandle,
+        const std::string& webRootPath,
+        bool verboseModeOn,
+        std::ostream& logger);
+
+    std::string transactionId() const;
+
+    // Parses a complete request header and queues the response
+    void prepareResponse(std::string_view header);
+
+    // Queues the responses to the complete requests in the input buffer
+    // until the batch is full
+    void processInput();
+
+    // Returns true if queued responses have to be sent before
+    // processing further requests
+    bool isBatchFull() const noexcept {
+        return _bodyFile || _txQueue.size() >= HTTP_SERVER_PIPELINE_DEPTH;
+    }
+
+    // Sends as much of the queued responses as the socket accepts
+    void sendResponse();
+
+    // Sends as much of the file body as the socket accepts
+    void sendBody();
+
+    // Sets the state following the transmission of queued responses
+    void onQueueSent() noexcept;
+
+    void closeBody() noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
+
+#endif // __HTTP_CONNECTION_H__
@@ -0,0 +1,160 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpDispatcher.h
+///\brief Hands the connections with a request ready over to a thread pool
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_DISPATCHER_H__
+#define __HTTP_DISPATCHER_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include "EventPoller.h"
+#include "HttpServerTask.h"
+#include "HttpTimeouts.h"
+#include "TcpListener.h"
+#include "ThreadPool.h"
+#include "TimerWheel.h"
+
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Accepts the connections of a listener and monitors them while they
+ * wait for a request, within the caller thread. Once a whole request
+ * header has been received, the connection is handed over to a worker
+ * of the thread pool, which serves it and then hands it back.
+ * So a worker is never engaged by a connection which is idle or slow
+ * in sending its request, and the time limits of the connections
+ * waiting for a request are enforced by the dispatcher.
+ */
+class HttpDispatcher {
+public:
+    HttpDispatcher(const HttpDispatcher&) = delete;
+    HttpDispatcher& operator=(const HttpDispatcher&) = delete;
+
+
+    /**
+     * Constructs the dispatcher.
+     *
+     * @param listener listening tcp socket
+     * @param threadPool pool of the workers serving the requests
+     * @param webRootPath local working directory of the web server
+     * @param verboseModeOn true to dump requests and responses on logger
+     * @param logger output stream used for logging
+     * @param timeouts time limits of the connections
+     */
+    HttpDispatcher(
+        TcpListener& listener,
+        ThreadPool& threadPool,
+        const std::string& webRootPath,
+        bool verboseModeOn,
+        std::ostream& logger,
+        const HttpTimeouts& timeouts = HttpTimeouts())
+        : _listener(listener)
+        , _threadPool(threadPool)
+        , _webRootPath(webRootPath)
+        , _verboseModeOn(verboseModeOn)
+        , _logger(logger)
+        , _timeouts(timeouts)
+    {
+    }
+
+    ~HttpDispatcher();
+
+
+    /**
+     * Creates the event poller and registers the listener with it.
+     * It is implicitly called by run() if not called before.
+     *
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool open();
+
+
+    /**
+     * Runs the event loop. This function is blocking for the caller.
+     * The connections handed over to the pool must be served before
+     * the dispatcher is destroyed.
+     *
+     * @return false if operation failed, otherwise the function
+     * doesn't return ever
+     */
+    bool run();
+
+private:
+    using SocketFd = TransportSocket::SocketFd;
+    using ConnectionMap =
+        std::unordered_map<SocketFd, HttpServerTask::Handle>;
+
+    TcpListener& _listener;
+    ThreadPool& _threadPool;
+    std::string _webRootPath;
+    bool _verboseModeOn = false;
+    std::ostream& _logger;
+    HttpTimeouts _timeouts;
+    EventPoller::Handle _poller;
+    int _wakeFd = -1; // signalled by the workers handing back connections
+    TimerWheel _timers; // outlives the connections
+    TimerWheel::Timer _acceptTimer; // re-enables the accept after errors
+
+    // Both the connections waiting for a request and the ones being
+    // served: the latter are referred by the workers
+    ConnectionMap _connections;
+
+    // Connections handed back by the workers, the vectors are swapped
+    // so that neither is reallocated
+    std::mutex _mtx;
+    std::vector<HttpServerTask*> _released;
+    std::vector<HttpServerTask*> _resumed;
+
+    // Accepts all the pending connections
+    void acceptConnections();
+
+    // Starts monitoring a connection waiting for a request
+    void monitor(ConnectionMap::iterator it);
+
+    // Receives the data of a connection, handing it over to the pool
+    // once a request is complete
+    void onRecvEvent(ConnectionMap::iterator it);
+
+    // Hands a connection back to the dispatcher, in a worker thread
+    void release(HttpServerTask* task);
+
+    // Monitors again the connections handed back by the workers
+    void resumeConnections();
+
+    // Closes the connections exceeding their time limits
+    void expireConnections();
+
+    void closeConnection(ConnectionMap::iterator it);
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
+
+#endif // __HTTP_DISPATCHER_H__
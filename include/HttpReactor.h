@@ -0,0 +1,122 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpReactor.h
+///\brief Single-threaded event loop serving HTTP connections
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_REACTOR_H__
+#define __HTTP_REACTOR_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+
+#include "EventPoller.h"
+#include "HttpConnection.h"
+#include "HttpTimeouts.h"
+#include "TcpListener.h"
+#include "TimerWheel.h"
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Serves all the connections accepted on a listener within the
+ * caller thread, by using non-blocking sockets and an edge-triggered
+ * readiness notification mechanism.
+ */
+class HttpReactor {
+public:
+    HttpReactor(const HttpReactor&) = delete;
+    HttpReactor& operator=(const HttpReactor&) = delete;
+
+
+    /**
+     * Constructs the reactor.
+     *
+     * @param listener listening tcp socket
+     * @param webRootPath local working directory of the web server
+     * @param verboseModeOn true to dump requests and responses on logger
+     * @param logger output stream used for logging
+     * @param timeouts time limits of the connections
+     */
+    HttpReactor(
+        TcpListener& listener,
+        const std::string& webRootPath,
+        bool verboseModeOn,
+        std::ostream& logger,
+        const HttpTimeouts& timeouts = HttpTimeouts())
+        : _listener(listener)
+        , _webRootPath(webRootPath)
+        , _verboseModeOn(verboseModeOn)
+        , _logger(logger)
+        , _timeouts(timeouts)
+    {
+    }
+
+
+    /**
+     * Creates the event poller and registers the listener with it.
+     * It is implicitly called by run() if not called before.
+     *
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool open();
+
+
+    /**
+     * Runs the event loop. This function is blocking for the caller.
+     *
+     * @return false if operation failed, otherwise the function
+     * doesn't return ever
+     */
+    bool run();
+
+private:
+    using SocketFd = TransportSocket::SocketFd;
+    using ConnectionMap = std::unordered_map<SocketFd, HttpConnection::Handle>;
+
+    TcpListener& _listener;
+    std::string _webRootPath;
+    bool _verboseModeOn = false;
+    std::ostream& _logger;
+    HttpTimeouts _timeouts;
+
+    EventPoller::Handle _poller;
+    TimerWheel _timers; // outlives the connections
+    TimerWheel::Timer _acceptTimer; // re-enables the accept after errors
+    ConnectionMap _connections;
+
+    // Accepts all the pending connections
+    void acceptConnections();
+
+    // Closes the connections exceeding their time limits
+    void expireConnections();
+
+    ConnectionMap::iterator closeConnection(ConnectionMap::iterator it);
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_EPOLL_SUPPORT
+
+#endif // __HTTP_REACTOR_H__
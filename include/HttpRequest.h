@@ -14,95 +14,112 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "config.h"
+
+#include <cstddef>
 #include <iostream>
-#include <list>
-#include <memory>
 #include <string>
+#include <string_view>
 
 
 /* -------------------------------------------------------------------------- */
 
 /**
  * Encapsulates HTTP style request, consisting of a request line,
- * some headers, and a content body
+ * some headers, and a content body.
+ * The request does not copy the header it is parsed from: URI and
+ * header fields are views into the parsed text, so the text must
+ * outlive the request (typically, it is the receive buffer of the
+ * connection). Parsing a request allocates no memory.
  */
 class HttpRequest {
 public:
-    using Handle = std::shared_ptr<HttpRequest>;
-
     enum class Method { GET, HEAD, POST, UNKNOWN };
     enum class Version { HTTP_1_0, HTTP_1_1, UNKNOWN };
 
-    HttpRequest() = default;
-    HttpRequest(const HttpRequest&) = default;
-
-
     /**
-     * Returns the request headers
+     * A header field, name and value are views into the parsed text,
+     * the value without the surrounding white spaces
      */
-    const std::list<std::string>& get_header() const { 
-       return _header; 
-    }
+    struct Field {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    HttpRequest() = default;
+    HttpRequest(const HttpRequest&) = default;
+    HttpRequest& operator=(const HttpRequest&) = default;
 
 
     /**
      * Returns the method of the command line (GET, HEAD, ...)
      */
-    const Method& getMethod() const noexcept { 
-       return _method; 
+    const Method& getMethod() const noexcept {
+       return _method;
     }
 
 
     /**
      * Returns the HTTP version (HTTP/1.0, HTTP/1.1, ...)
      */
-    const Version& getVersion() const noexcept { 
-       return _version; 
+    const Version& getVersion() const noexcept {
+       return _version;
     }
 
 
     /**
      * Returns the command line URI
      */
-    const std::string& getUri() const noexcept { 
-       return _uri; 
+    std::string_view getUri() const noexcept {
+       return _uri;
     }
 
 
     /**
-     * Parses the HTTP method.
-     *
-     * @param method input string
+     * Returns the number of header fields.
      */
-    void parseMethod(const std::string& method);
+    size_t getFieldCount() const noexcept {
+        return _fieldCount;
+    }
 
 
     /**
-     * Parses the URI field.
+     * Returns a header field.
      *
-     * @param uri The input string to parse
+     * @param index The index of the field, less than getFieldCount()
      */
-    void parseUri(const std::string& uri) {
-        _uri = uri == "/" ? "index.html" : uri;
+    const Field& getFieldAt(size_t index) const noexcept {
+        return _fields[index];
     }
 
 
     /**
-     * Parses the HTTP version.
+     * Returns the value of a header field, without the surrounding
+     * white spaces. Field names are compared ignoring the case.
      *
-     * @param ver The input string to parse
+     * @param name The field name, e.g. "Range"
+     * @return the value of the first field matching the name, or
+     *         an empty view if the request has no such field
      */
-    void parseVersion(const std::string& ver);
+    std::string_view getField(std::string_view name) const noexcept;
 
 
     /**
-     * Adds a new header to request
+     * Parses a whole request header in a single pass, i.e. the request
+     * line followed by the header fields, each terminated by a CRLF
+     * sequence (a bare LF is tolerated).
+     * The empty line closing the header is not expected to be part of
+     * the input string.
+     * A malformed header (e.g. a request line not made of three tokens,
+     * a field without colon, more than HTTP_SERVER_MAX_HEADER_FIELDS
+     * fields) leaves the method unknown, so that the request is
+     * rejected.
      *
-     * @param new_header The header content to add to headers fields
+     * @param header The input string to parse, which must outlive
+     *               the request
+     * @return true if the header is well-formed, false otherwise
      */
-    void addHeader(const std::string& new_header) {
-        _header.push_back(new_header);
-    }
+    bool parse(std::string_view header) noexcept;
 
 
     /**
@@ -116,10 +133,21 @@ public:
 
 
 private:
-    std::list<std::string> _header;
+    std::string_view _header;
     Method _method = Method::UNKNOWN;
     Version _version = Version::UNKNOWN;
-    std::string _uri;
+    std::string_view _uri;
+    Field _fields[HTTP_SERVER_MAX_HEADER_FIELDS];
+    size_t _fieldCount = 0;
+
+    static Method parseMethod(std::string_view method) noexcept;
+    static Version parseVersion(std::string_view ver) noexcept;
+
+    // Parses the request line, without line terminator
+    bool parseRequestLine(std::string_view line) noexcept;
+
+    // Adds a header field, the value without line terminator
+    bool parseField(std::string_view name, std::string_view value) noexcept;
 };
 
 
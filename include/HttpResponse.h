@@ -14,10 +14,13 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "Arena.h"
+#include "ContentCache.h"
+#include "FileCache.h"
 #include "HttpRequest.h"
 
-#include <map>
 #include <string>
+#include <string_view>
 
 
 /* -------------------------------------------------------------------------- */
@@ -38,14 +41,20 @@ public:
      *
      * @param request an http request
      * @param webRootPath local working directory of the web server
+     * @param arena the memory the response header and the path are
+     *              allocated from, which has to outlive the response
+     *              until it has been sent
      */
-    HttpResponse(const HttpRequest& request, const std::string& webRootPath);
+    HttpResponse(
+        const HttpRequest& request, 
+        const std::string& webRootPath,
+        Arena& arena);
 
 
     /**
      * Returns the content of response status line and response headers.
      */
-    operator const std::string&() const { 
+    operator std::string_view() const noexcept { 
        return _response; 
     }
 
@@ -53,11 +62,115 @@ public:
     /**
      * Returns the content of local resource related to the URI requested.
      */
-    const std::string& getLocalUriPath() const {
+    const std::pmr::string& getLocalUriPath() const noexcept {
         return _localUriPath;
     }
 
 
+    /**
+     * Returns the entry of the file to be sent as response body,
+     * empty if the response has no body file.
+     */
+    const FileCache::Entry::Handle& getFileEntry() const noexcept {
+        return _fileEntry;
+    }
+
+
+    /**
+     * Returns the response body held in memory, empty if the body
+     * has to be read from the file or if the response has no body.
+     */
+    const ContentCache::Content& getContent() const noexcept {
+        return _content;
+    }
+
+
+    /**
+     * Returns the offset, within the file or the content in memory,
+     * of the first byte of the body: it is non-zero when a byte range
+     * has been requested (206 Partial Content).
+     */
+    int64_t getBodyOffset() const noexcept {
+        return _bodyOffset;
+    }
+
+
+    /**
+     * Returns the number of bytes of the body.
+     */
+    int64_t getBodySize() const noexcept {
+        return _bodySize;
+    }
+
+
+    /**
+     * Returns true if a non-empty body has to be sent from the file
+     * returned by getFileEntry(), following the header.
+     */
+    bool hasFileBody() const noexcept {
+        return _fileBody;
+    }
+
+
+    /**
+     * Returns the status code of the response (200, 403, 404, ...)
+     */
+    int getStatusCode() const noexcept {
+        return _statusCode;
+    }
+
+
+    /**
+     * Formats the part of a positive response header which depends on
+     * the requested file only, i.e. all of it except the Date field and 
+     * the empty line closing the header.
+     * The status line and the Content-Length field come first, so
+     * that a partial response can replace them and reuse the rest.
+     *
+     * @param header The output string
+     * @param fileEntry The requested file
+     */
+    static void formatFileHeader(
+        std::string& header, 
+        const FileCache::Entry& fileEntry);
+
+
+    /**
+     * Formats the part of a positive response header of a file served
+     * as the precompressed variant of another one (e.g. "foo.js.gz" in
+     * place of "foo.js"): the MIME type is the one of the other file,
+     * and the content coding the one of the extension.
+     *
+     * @param header The output string, left empty if the extension
+     *               is not the one of a supported content coding
+     * @param fileEntry The precompressed file
+     */
+    static void formatEncodedHeader(
+        std::string& header, 
+        const FileCache::Entry& fileEntry);
+
+
+    /**
+     * Formats the part of a positive response header which depends on
+     * the representation of a file only (@see formatFileHeader()).
+     *
+     * @param header The output string
+     * @param size The size of the representation
+     * @param modTime The time of last modification of the file
+     * @param etag The entity tag of the representation
+     * @param ext The file extension, which the MIME type is resolved of
+     * @param encoding The content coding of the representation (e.g.
+     *                 "gzip"), nullptr if the content is not encoded
+     */
+    static void formatFileHeader(
+        std::string& header, 
+        int64_t size,
+        time_t modTime,
+        const std::string& etag,
+        const std::string& ext,
+        const char* encoding);
+
+
     /**
      * Prints the response out to os stream.
      *
@@ -68,23 +181,94 @@ public:
     std::ostream& dump(std::ostream& os, const std::string& id = "");
 
 private:
-    static std::map<std::string, std::string> _mimeTbl;
+    // A content coding of precompressed files
+    struct Encoding {
+        const char* name; // as listed by Accept-Encoding
+        const char* ext;  // extension of the precompressed file
+    };
 
-    std::string _response;
-    std::string _localUriPath;
+    enum { BROTLI, GZIP };
 
-    // Format an error response
+    static const Encoding _encodings[];
+
+    std::pmr::string _response;
+    std::pmr::string _localUriPath;
+    FileCache::Entry::Handle _fileEntry;
+    ContentCache::Content _content;
+    int _statusCode = 0;
+    int64_t _bodyOffset = 0;
+    int64_t _bodySize = 0;
+    bool _fileBody = false;
+
+    // Format an error response, optionally adding some header fields,
+    // each one terminated by CRLF
     static void formatError(
-        std::string& output, 
+        std::pmr::string& output, 
         int code, 
-        const std::string& msg);
+        const std::string& msg,
+        const std::string& fields = std::string());
+
+    // Format the response carrying the metrics of the server,
+    // in Prometheus text format
+    void formatStats(bool headOnly);
 
-    // Format an positive response
+    // Format an positive response from a file header, adding the
+    // Vary field if the file has encoded variants
     static void formatPositiveResponse(
-        std::string& response, 
-        std::string& fileTime,
-        std::string& fileExt,
-        size_t& contentLen);
+        std::pmr::string& response, 
+        const std::string& header,
+        bool vary);
+
+    // Format the header-only response to a conditional request
+    // matching the cached representation of the client
+    static void formatNotModified(
+        std::pmr::string& response, 
+        const std::string& etag,
+        bool vary);
+
+    // Evaluates If-None-Match, or If-Modified-Since when the former
+    // is not present, returning true if the representation having
+    // the given validators is not modified
+    static bool isNotModified(
+        const HttpRequest& request, 
+        const std::string& etag,
+        time_t modTime);
+
+    // Format a positive response to a byte range request from
+    // a file header
+    static void formatPartialResponse(
+        std::pmr::string& response, 
+        const std::string& header,
+        int64_t size,
+        int64_t first,
+        int64_t last,
+        bool vary);
+
+    // Returns true if a content coding is accepted by the value
+    // of an Accept-Encoding field, i.e. listed, explicitly or by
+    // "*", with a non-zero quality
+    static bool isAccepted(std::string_view field, const char* coding);
+
+    // Returns the precompressed variant of a file, if any, that the
+    // value of Accept-Encoding accepts, along with its coding; sets
+    // hasVariants if the file has any variant, accepted or not
+    static FileCache::Entry::Handle findEncodedVariant(
+        std::string_view acceptEncoding,
+        const std::pmr::string& localPath,
+        const Encoding*& encoding,
+        bool& hasVariants);
+
+    // Parses the value of a Range field for a file of the given size.
+    // The bounds are only set when a satisfiable range is found.
+    // Returns 206 and the bounds of a satisfiable range, 416 if the
+    // range is not satisfiable, or 200 if the field has to be ignored
+    // (malformed, or a multiple ranges request) and the whole file
+    // has to be sent.
+    static int parseRange(
+        std::string_view field, 
+        int64_t size, 
+        int64_t& first, 
+        int64_t& last);
 };
 
 
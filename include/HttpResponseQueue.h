@@ -0,0 +1,144 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpResponseQueue.h
+///\brief Responses waiting to be transmitted on a connection
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_RESPONSE_QUEUE_H__
+#define __HTTP_RESPONSE_QUEUE_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "ContentCache.h"
+#include "HttpResponse.h"
+#include "HttpStats.h"
+#include "TransportSocket.h"
+
+#include <string_view>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Collects the responses to pipelined requests, so that they can be
+ * transmitted by a single gathered write rather than one at a time.
+ * For each response the queue holds the header and the body held in
+ * memory, if any; a body to be sent from file is not part of the queue
+ * and has to follow its transmission.
+ */
+class HttpResponseQueue {
+public:
+    /**
+     * Appends a response to the queue.
+     * The header is not copied: it has to stay valid until the
+     * response is sent, as it happens when it has been allocated
+     * from the arena of the connection.
+     *
+     * @param response the response
+     * @param received the time the request was received at, which
+     *                 the latency of the response is measured from
+     */
+    void push(
+        const HttpResponse& response, 
+        HttpStats::Clock::time_point received);
+
+
+    /**
+     * Returns true if there is nothing to transmit.
+     */
+    bool empty() const noexcept {
+        return _head == _items.size();
+    }
+
+
+    /**
+     * Returns the number of responses not completely transmitted.
+     */
+    size_t size() const noexcept {
+        return _items.size() - _head;
+    }
+
+
+    /**
+     * Describes the data not transmitted yet as a sequence of buffers,
+     * suitable for a gathered write.
+     *
+     * @param buffers The array receiving the buffers
+     * @param maxCount The size of the array
+     * @return the number of buffers filled in
+     */
+    int fill(TransportSocket::Buffer* buffers, int maxCount) const noexcept;
+
+
+    /**
+     * Marks data as transmitted, removing the responses completely
+     * sent from the queue. The latencies of the responses are counted
+     * in the metrics; the one of a response whose body follows from
+     * file has to be counted once the body has been sent.
+     *
+     * @param bytes The number of bytes sent
+     */
+    void consume(size_t bytes) noexcept;
+
+
+    /**
+     * Sends as much of the queued data as the socket accepts in a
+     * single gathered write. Responses completely sent are removed
+     * from the queue.
+     *
+     * @param socket The connected socket
+     * @param flags A set of flags that specify the way in which the
+     *              call is made (@see TransportSocket::sendv())
+     * @return the number of bytes sent, or -1 in case of error
+     *         (the error code can be retrieved by errno)
+     */
+    int64_t send(TransportSocket& socket, int flags = 0) noexcept;
+
+
+    /**
+     * Discards all the queued responses.
+     */
+    void clear() noexcept {
+        _items.clear();
+        _head = 0;
+        _offset = 0;
+    }
+
+private:
+    struct Item {
+        std::string_view header;
+        ContentCache::Content content;
+        size_t contentOffset = 0; // the body may be a range of content
+        size_t contentSize = 0;
+        HttpStats::Clock::time_point received;
+        bool fileBody = false; // sent once the item is
+
+        size_t size() const noexcept {
+            return header.size() + contentSize;
+        }
+    };
+
+    // Sent items are skipped rather than erased, until the queue is
+    // drained, so that it is not reallocated once grown
+    std::vector<Item> _items;
+    size_t _head = 0; // the first item not sent yet
+    size_t _offset = 0; // bytes of the first item already sent
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __HTTP_RESPONSE_QUEUE_H__
@@ -15,13 +15,21 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "AccessLog.h"
+#include "ContentCache.h"
+#include "FileCache.h"
 #include "HttpSocket.h"
+#include "HttpStats.h"
+#include "HttpTimeouts.h"
+#include "MimeTypes.h"
 #include "TcpListener.h"
+#include "ThreadPool.h"
 
 #include "config.h"
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 
 /* -------------------------------------------------------------------------- */
@@ -38,12 +46,32 @@ private:
     std::ostream* _loggerOStreamPtr = &std::clog;
     static HttpServer* _instance;
     TranspPort _serverPort = DEFAULT_PORT;
-    TcpListener::Handle _tcpServer;
+    std::vector<TcpListener::Handle> _listeners;
+    size_t _listenerShards = HTTP_SERVER_LISTENER_SHARDS;
     std::string _webRootPath = "/tmp";
     bool _verboseModeOn = true;
+    bool _reactorModeOn = false;
+    bool _ioUringOn = false;
+    size_t _threadPoolSize = HTTP_SERVER_THREADS;
+    HttpTimeouts _timeouts;
 
     HttpServer() = default;
 
+    // Runs the worker thread pool server
+    bool runThreads();
+
+#ifndef HTTP_SERVER_EPOLL_SUPPORT
+    // Accepts the connections of a listener shard and submits them
+    // to the thread pool
+    void acceptConnections(size_t shard, ThreadPool& threadPool);
+#endif
+
+    // Runs the event-driven server
+    bool runReactor();
+
+    // Runs an event loop of the given type for each listener
+    template <class Reactor> bool runReactors();
+
 public:
     HttpServer(const HttpServer&) = delete;
     HttpServer& operator=(const HttpServer&) = delete;
@@ -86,6 +114,155 @@ public:
         _webRootPath = webRootPath;
     }
 
+    /**
+     * Selects the server concurrency model.
+     * In reactor mode all the connections are served by a single
+     * thread running an event loop; otherwise each accepted connection
+     * is handed over to a pool of worker threads.
+     *
+     * @param on true to enable the reactor mode
+     * @return false if reactor mode is not supported on this platform,
+     * true otherwise
+     */
+    bool setupReactorMode(bool on) {
+#ifdef HTTP_SERVER_EPOLL_SUPPORT
+        _reactorModeOn = on;
+        return true;
+#else
+        return !on;
+#endif
+    }
+
+    /**
+     * Selects io_uring as I/O backend of the reactor mode, in place
+     * of epoll. The backend requires Linux 6.0 or later: if it is not
+     * available, the server keeps using epoll.
+     *
+     * @param on true to use io_uring
+     * @return false if io_uring was requested but it is not supported
+     * by the platform or the running kernel, true otherwise
+     */
+    bool setupIoUring(bool on);
+
+    /**
+     * Sets the number of worker threads serving the connections
+     * when reactor mode is off. Each worker serves one connection
+     * at a time, once a whole request has been received: while
+     * waiting for requests, the connections are monitored by the
+     * acceptor threads.
+     *
+     * @param threads number of threads, zero means the number of
+     * hardware threads
+     */
+    void setupThreadPoolSize(size_t threads) {
+        _threadPoolSize = threads;
+    }
+
+    /**
+     * Sets the time limits of the connections: a connection idle
+     * between requests, slow in sending a request header, or not
+     * accepting the response is closed once over the limit.
+     *
+     * @param timeouts the limits, in seconds
+     */
+    void setupTimeouts(const HttpTimeouts& timeouts) {
+        _timeouts = timeouts;
+    }
+
+    /**
+     * Sets the number of listening sockets bound to the server port.
+     * When more than one, each socket is opened with SO_REUSEPORT and
+     * has its own accept loop (its own event loop in reactor mode),
+     * and the kernel balances the incoming connections among them.
+     * It must be called before bind().
+     *
+     * @param shards number of listeners, zero means the number of
+     * hardware threads
+     * @return false if multiple listeners are not supported on this 
+     * platform, true otherwise
+     */
+    bool setupListenerShards(size_t shards) {
+#ifdef HTTP_SERVER_REUSEPORT_SUPPORT
+        _listenerShards = shards;
+        return true;
+#else
+        _listenerShards = 1;
+        return shards == 1;
+#endif
+    }
+
+    /**
+     * Returns the number of listeners bound to the server port.
+     */
+    size_t getListenerShards() const noexcept {
+        return _listeners.size();
+    }
+
+    /**
+     * Configures the cache of open files shared by all the connections
+     *
+     * @param maxEntries maximum number of open files kept in cache,
+     * zero disables the cache
+     * @param ttl time in seconds after which a cached file is checked 
+     * again for changes
+     */
+    void setupFileCache(size_t maxEntries, int ttl) {
+        FileCache::getInstance().setup(maxEntries, ttl);
+    }
+
+    /**
+     * Sets the path the server metrics are served at
+     *
+     * @param path request URI of the metrics, empty disables them
+     */
+    void setupStats(const std::string& path) {
+        HttpStats::getInstance().setup(path);
+    }
+
+    /**
+     * Configures the in-memory cache of file contents
+     *
+     * @param budget maximum number of bytes kept in memory,
+     * zero disables the cache
+     * @param maxEntrySize size in bytes of the largest file cached
+     */
+    void setupContentCache(size_t budget, size_t maxEntrySize) {
+        ContentCache::getInstance().setup(budget, maxEntrySize);
+    }
+
+    /**
+     * Configures the on-the-fly gzip compression of text files
+     *
+     * @param budget maximum number of compressed bytes kept in memory,
+     * zero disables the compression
+     * @return false if the compression was requested but it is not
+     * supported by this build, true otherwise
+     */
+    bool setupGzipCache(size_t budget);
+
+    /**
+     * Opens the access log
+     *
+     * @param fileName path of the file, "-" for the standard output
+     * @param format format of the lines
+     * @return true if operation is successfully completed, false otherwise
+     */
+    bool setupAccessLog(
+        const std::string& fileName, AccessLog::Format format)
+    {
+        return AccessLog::getInstance().open(fileName, format);
+    }
+
+    /**
+     * Loads additional MIME types from a file in mime.types format
+     *
+     * @param fileName path of the file
+     * @return true if operation is successfully completed, false otherwise
+     */
+    bool setupMimeTypes(const std::string& fileName) {
+        return MimeTypes::load(fileName);
+    }
+
     /**
      * Gets the port where server is listening
      *
@@ -123,12 +300,14 @@ public:
 protected:
     /**
      * Accepts a new connection from a remote client.
-     * This function blocks until connection is established or
-     * an error occurs.
+     * The connection is returned in blocking mode. The function does
+     * not block if the listener is in non-blocking mode: it fails with 
+     * EAGAIN when no connection is pending.
+     * @param shard index of the listener
      * @return a handle to tcp socket
      */
-    TcpSocket::Handle accept() { 
-       return _tcpServer->accept(); 
+    TcpSocket::Handle accept(size_t shard = 0) { 
+       return _listeners[shard]->accept(); 
     }
 };
 
@@ -0,0 +1,195 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpServerTask.h
+///\brief HTTP connection served by the worker thread pool
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_SERVER_TASK_H__
+#define __HTTP_SERVER_TASK_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpSocket.h"
+#include "HttpStats.h"
+#include "HttpTimeouts.h"
+#include "TcpSocket.h"
+#include "TimerWheel.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * This class represents an HTTP connection served by the worker
+ * thread pool.
+ * A worker is only engaged once a whole request has been received:
+ * while the connection waits for a request, it is monitored by the
+ * acceptor thread of its listener (@see HttpDispatcher), which
+ * receives the data on its behalf.
+ */
+class HttpServerTask {
+public:
+    using Handle = std::shared_ptr<HttpServerTask>;
+
+    HttpServerTask(const HttpServerTask&) = delete;
+    HttpServerTask& operator=(const HttpServerTask&) = delete;
+
+
+    /**
+     * Returns a handle to a new task object.
+     *
+     * @param verboseModeOn true to dump requests and responses on logger
+     * @param logger output stream used for logging
+     * @param socketHandle connected tcp socket, in blocking mode
+     * @param webRootPath local working directory of the web server
+     * @param timeouts time limits of the connection
+     * @return the handle to a new task object instance
+     */
+    static Handle create(
+        bool verboseModeOn,
+        std::ostream& logger,
+        TcpSocket::Handle socketHandle,
+        const std::string& webRootPath,
+        const HttpTimeouts& timeouts)
+    {
+        return Handle(new HttpServerTask(
+            verboseModeOn, logger, socketHandle, webRootPath, timeouts));
+    }
+
+
+    /**
+     * Receives the data available on the socket, without waiting for
+     * more (@see HttpSocket::receive()).
+     *
+     * @return false if the connection has to be closed, true otherwise
+     */
+    bool receive() {
+        return _httpSocket.receive();
+    }
+
+
+    /**
+     * Returns true if a whole request has been received and is
+     * waiting to be served.
+     */
+    bool hasPendingRequest() const noexcept {
+        return _httpSocket.hasPendingRequest();
+    }
+
+
+    /**
+     * Returns true if the connection is waiting for a new request,
+     * after the previous one has been answered, and no byte of it
+     * has been received yet.
+     */
+    bool isIdle() const noexcept {
+        return _requestCount && !_httpSocket.hasPendingData();
+    }
+
+
+    /**
+     * Serves the requests already received. It blocks the caller
+     * while the responses are being sent, never to wait for requests.
+     *
+     * @return false if the connection has been closed, true if it is
+     *         open and waiting for a new request
+     */
+    bool serve();
+
+
+    /**
+     * Serves the connection in the caller thread until it is closed,
+     * waiting for the requests within the time limits. It is used
+     * where the connections cannot be monitored by their acceptor.
+     */
+    void operator()();
+
+
+    /**
+     * Closes the connection.
+     */
+    void close();
+
+
+    /**
+     * Returns true if the connection has been closed
+     */
+    bool isClosed() const noexcept {
+        return _closed;
+    }
+
+
+    /**
+     * Reports to the metrics whether the connection is idle
+     * (@see isIdle())
+     */
+    void updateStats() noexcept {
+        _stats.setIdle(isIdle());
+    }
+
+
+    /**
+     * Returns the timer enforcing the time limits of the connection
+     * while it waits for a request. Its context is the task.
+     */
+    TimerWheel::Timer& getTimer() noexcept {
+        return _timer;
+    }
+
+
+    /**
+     * Returns the time limits of the connection
+     */
+    const HttpTimeouts& getTimeouts() const noexcept {
+        return _timeouts;
+    }
+
+
+    /**
+     * Returns the socket descriptor of the connection
+     */
+    const TcpSocket::SocketFd& getSocketFd() const noexcept {
+        return _socketHandle->getSocketFd();
+    }
+
+private:
+    bool _verboseModeOn = false;
+    std::ostream& _logger;
+    TcpSocket::Handle _socketHandle;
+    HttpSocket _httpSocket;
+    std::string _webRootPath;
+    HttpTimeouts _timeouts;
+    uint64_t _requestCount = 0;
+    bool _closed = false;
+    HttpStats::Connection _stats;
+    TimerWheel::Timer _timer { this };
+
+    HttpServerTask(
+        bool verboseModeOn,
+        std::ostream& logger,
+        TcpSocket::Handle socketHandle,
+        const std::string& webRootPath,
+        const HttpTimeouts& timeouts);
+
+    std::string transactionId() const;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __HTTP_SERVER_TASK_H__
@@ -22,11 +22,16 @@
 
 #include "TcpSocket.h"
 
+#include "Arena.h"
+#include "CharScanner.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "HttpResponseQueue.h"
+#include "HttpStats.h"
 
 #include "config.h"
 
+#include <chrono>
 #include <string>
 
 
@@ -43,15 +48,20 @@ class HttpSocket {
 private:
     TcpSocket::Handle _socketHandle;
     bool _connUp = true;
-    HttpRequest::Handle recv();
-    int _connectionTimeOut = HTTP_CONNECTION_TIMEOUT; // secs
+    std::string _rxBuffer;
+    size_t _rxConsumed = 0; // bytes of the last request received
+    HttpStats::Clock::time_point _rxTime; // of the last request received
+    HttpResponseQueue _txQueue;
+    Arena _arena; // backs the queued responses
+    std::chrono::seconds _headerTimeout { HTTP_HEADER_TIMEOUT };
+    void recv(HttpRequest& request);
+    void flush(int flags);
 
 public:
-    HttpSocket(int connectionTimeout = HTTP_CONNECTION_TIMEOUT) noexcept :
-        _connectionTimeOut(connectionTimeout) 
-    {}
+    HttpSocket() = default;
 
-    HttpSocket(const HttpSocket&) = default;
+    HttpSocket(const HttpSocket&) = delete;
+    HttpSocket& operator=(const HttpSocket&) = delete;
 
     /**
      * Construct the HTTP connection starting from TCP connected-socket handle.
@@ -73,15 +83,55 @@ public:
        return _socketHandle; 
     }
 
+    /**
+     * Returns the memory which the responses to the requests received
+     * by this socket are allocated from. It is released when the next
+     * request is received, if the queued responses have been sent by
+     * then, so the responses must not be used beyond that point.
+     */
+    Arena& getArena() noexcept {
+        return _arena;
+    }
+
     /**
      * Receives an HTTP request from remote peer.
-     * @param the handle of http request object
+     * The request refers to the receive buffer of the socket, so it is
+     * valid until the next request is received.
+     * @param request the http request object
      */
-    HttpSocket& operator>>(HttpRequest::Handle& handle) {
-        handle = recv();
+    HttpSocket& operator>>(HttpRequest& request) {
+        recv(request);
         return *this;
     }
 
+    /**
+     * Receives the data available on the socket, without waiting for
+     * more: a single read is performed, so it is meant to be called
+     * once the socket is readable.
+     * @return false if the connection is down or has been closed by
+     * the remote peer, or the request header exceeds its maximum size;
+     * true otherwise
+     */
+    bool receive();
+
+    /**
+     * Returns true if received bytes following the last request
+     * (e.g. a pipelined request) are waiting to be processed.
+     */
+    bool hasPendingData() const noexcept {
+        return _rxBuffer.size() > _rxConsumed;
+    }
+
+    /**
+     * Returns true if a complete request (e.g. a pipelined request)
+     * has been already received and is waiting to be processed.
+     */
+    bool hasPendingRequest() const noexcept {
+        return CharScanner::findHeaderEnd(
+            std::string_view(_rxBuffer).substr(_rxConsumed))
+            != CharScanner::npos;
+    }
+
     /**
      * Returns false if last recv/send operation detected
      * that connection was down; true otherwise.
@@ -92,24 +142,37 @@ public:
 
     /**
      * Send a response to remote peer.
+     * While further pipelined requests are already available, the
+     * response is queued, up to HTTP_SERVER_PIPELINE_DEPTH responses,
+     * and the queue is transmitted by a single write once the last
+     * of them has been processed.
+     * The queue is always transmitted before a response whose body has
+     * to be sent from file (@see HttpResponse::hasFileBody()).
      * @param response The HTTP response
      */
     HttpSocket& operator<<(const HttpResponse& response);
 
 
     /**
-     * Send a response to remote peer.
-     * @param response The HTTP response
+     * Send the body of a response from file to remote peer.
+     * @param response The HTTP response (@see HttpResponse::hasFileBody())
+     * @return the number of bytes sent, -1 in case of error
      */
-    int sendFile(const std::string& fileName) {
-        return _socketHandle->sendFile(fileName);
+    int64_t sendFile(const HttpResponse& response);
+
+    /**
+     * Returns the time allowed to receive a whole request header,
+     * from its first byte on
+     */
+    const std::chrono::seconds& getHeaderTimeout() const noexcept {
+        return _headerTimeout;
     }
 
-    /*
-     * Return connection timeout interval in seconds
+    /**
+     * Sets the time allowed to receive a whole request header
      */
-    const int& getConnectionTimeout() const noexcept {
-        return _connectionTimeOut;
+    void setHeaderTimeout(const std::chrono::seconds& timeout) noexcept {
+        _headerTimeout = timeout;
     }
 };
 
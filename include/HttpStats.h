@@ -0,0 +1,209 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpStats.h
+///\brief Server metrics, exposed in Prometheus text format
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_STATS_H__
+#define __HTTP_STATS_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "HttpRequest.h"
+#include "TcpListener.h"
+#include "config.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Collects the metrics of the server: requests by method and status,
+ * bytes sent, connections, accept errors, cache lookups and latency
+ * histograms.
+ * Each thread counts on its own set of counters, which no other thread
+ * writes, so that counting involves neither locks nor shared cache
+ * lines. The sets are only summed up when the metrics are requested.
+ */
+class HttpStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Cache { FILE, CONTENT, GZIP };
+
+    HttpStats(const HttpStats&) = delete;
+    HttpStats& operator=(const HttpStats&) = delete;
+
+
+    /**
+     * Gets HttpStats object instance reference, shared by all
+     * the threads.
+     *
+     * @return the HttpStats reference
+     */
+    static auto getInstance() -> HttpStats&;
+
+
+    /**
+     * Sets the path the metrics are served at, it must be called
+     * before the server runs.
+     *
+     * @param path the request URI of the metrics, empty disables them
+     */
+    void setup(const std::string& path) {
+        _path = path;
+    }
+
+
+    /**
+     * Sets the listeners whose accepted connections are reported,
+     * one series per listener, it must be called before the server
+     * runs.
+     *
+     * @param listeners the listeners, which must outlive the server
+     */
+    void setListeners(std::vector<const TcpListener*> listeners) {
+        _listeners = std::move(listeners);
+    }
+
+
+    /**
+     * Returns true if the metrics are served at the given URI.
+     */
+    bool isStatsUri(std::string_view uri) const noexcept {
+        return !_path.empty() && uri == _path;
+    }
+
+
+    /**
+     * Formats the metrics in Prometheus text exposition format.
+     *
+     * @param output The output string
+     */
+    void format(std::string& output) const;
+
+
+    /**
+     * Counts a request, once its response has been prepared.
+     *
+     * @param method The request method
+     * @param statusCode The status code of the response
+     */
+    static void countRequest(
+        HttpRequest::Method method, int statusCode) noexcept;
+
+
+    /**
+     * Counts the time from the reception of a request to the
+     * transmission of the first byte of its response.
+     */
+    static void countFirstByte(Clock::duration latency) noexcept;
+
+
+    /**
+     * Counts the time from the reception of a request to the
+     * transmission of the last byte of its response.
+     */
+    static void countResponse(Clock::duration latency) noexcept;
+
+
+    /**
+     * Counts bytes sent to the clients, either header or body ones.
+     */
+    static void countBytesSent(uint64_t bytes) noexcept;
+
+
+    /**
+     * Counts a failed accept of a connection.
+     */
+    static void countAcceptError() noexcept;
+
+
+    /**
+     * Counts a request not logged, as the access log was not keeping
+     * up with the requests (@see AccessLog).
+     */
+    static void countAccessLogDrop() noexcept;
+
+
+    /**
+     * Counts a lookup of a cache.
+     *
+     * @param cache The cache
+     * @param hit true if the entry was found in the cache
+     */
+    static void countCacheLookup(Cache cache, bool hit) noexcept;
+
+
+    /**
+     * Accounts for a connection as long as it exists, and for the
+     * time it is idle. It has to be created and destroyed by the
+     * thread serving the connection.
+     */
+    class Connection {
+    public:
+        Connection() noexcept;
+        ~Connection();
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        /**
+         * Sets whether the connection is idle, i.e. waiting for a
+         * new request after the previous one has been answered.
+         */
+        void setIdle(bool idle) noexcept;
+
+    private:
+        bool _idle = false;
+    };
+
+private:
+    struct Counters;
+    friend class Connection;
+
+    std::string _path = HTTP_STATS_PATH;
+    std::vector<const TcpListener*> _listeners;
+
+    // The counters of the running threads and the sum of the ones
+    // of the terminated threads
+    mutable std::mutex _mtx;
+    std::vector<Counters*> _threadCounters;
+    std::unique_ptr<Counters> _retiredCounters;
+
+    HttpStats();
+    ~HttpStats();
+
+    // Returns the counters of the calling thread
+    static Counters& getThreadCounters() noexcept;
+
+    // Makes the counters of a thread part of the metrics
+    void attach(Counters* counters);
+
+    // Adds the counters of a terminating thread to the retired ones
+    void detach(Counters* counters) noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __HTTP_STATS_H__
@@ -0,0 +1,52 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpTimeouts.h
+///\brief Time limits of the connections
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_TIMEOUTS_H__
+#define __HTTP_TIMEOUTS_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#include <chrono>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Time limits of a connection, each applying to a different phase:
+ * a connection is closed as soon as it exceeds the limit of the
+ * phase it is in.
+ */
+struct HttpTimeouts {
+    // Keep-alive connection waiting for a new request
+    std::chrono::seconds idle { HTTP_IDLE_TIMEOUT };
+
+    // Request header being received, from its first byte on (from the
+    // connection on, for the first request): a client trickling the
+    // header is not granted any longer
+    std::chrono::seconds header { HTTP_HEADER_TIMEOUT };
+
+    // Response being sent, without the client accepting any byte
+    std::chrono::seconds send { HTTP_SEND_TIMEOUT };
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __HTTP_TIMEOUTS_H__
@@ -0,0 +1,179 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file HttpUringReactor.h
+///\brief Event loop serving HTTP connections through io_uring
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __HTTP_URING_REACTOR_H__
+#define __HTTP_URING_REACTOR_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#ifdef HTTP_SERVER_IO_URING_SUPPORT
+
+#include "HttpConnection.h"
+#include "HttpTimeouts.h"
+#include "IoUring.h"
+#include "TcpListener.h"
+#include "TimerWheel.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Serves all the connections accepted on a listener within the
+ * caller thread, like HttpReactor, but using completion based I/O:
+ * connections are accepted by a multishot accept operation, data is
+ * received by multishot recv operations into buffers provided by the
+ * reactor, and the queued responses are sent by gathered writes, all
+ * of them submitted to the kernel in batches.
+ * File bodies are still transmitted by sendfile, on readiness.
+ */
+class HttpUringReactor {
+public:
+    HttpUringReactor(const HttpUringReactor&) = delete;
+    HttpUringReactor& operator=(const HttpUringReactor&) = delete;
+
+
+    /**
+     * Constructs the reactor.
+     *
+     * @param listener listening tcp socket
+     * @param webRootPath local working directory of the web server
+     * @param verboseModeOn true to dump requests and responses on logger
+     * @param logger output stream used for logging
+     * @param timeouts time limits of the connections
+     */
+    HttpUringReactor(
+        TcpListener& listener,
+        const std::string& webRootPath,
+        bool verboseModeOn,
+        std::ostream& logger,
+        const HttpTimeouts& timeouts = HttpTimeouts())
+        : _listener(listener)
+        , _webRootPath(webRootPath)
+        , _verboseModeOn(verboseModeOn)
+        , _logger(logger)
+        , _timeouts(timeouts)
+    {
+    }
+
+
+    /**
+     * Returns true if the running kernel provides all the io_uring
+     * features used by the reactor.
+     */
+    static bool isSupported();
+
+
+    /**
+     * Creates the ring and submits the accept operation.
+     * It is implicitly called by run() if not called before.
+     *
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool open();
+
+
+    /**
+     * Runs the event loop. This function is blocking for the caller.
+     *
+     * @return false if operation failed, otherwise the function
+     * doesn't return ever
+     */
+    bool run();
+
+private:
+    using SocketFd = TransportSocket::SocketFd;
+
+    // Operation kinds, encoded in the low bits of the user data
+    enum Operation : uint64_t {
+        OP_ACCEPT, OP_RECV, OP_SEND, OP_POLL, OP_BACKOFF, OP_MASK = 7
+    };
+
+    enum { BUFFER_GROUP = 0 };
+
+    // The state of a connection as seen by the ring. The context
+    // outlives its connection until all the operations submitted
+    // for the connection are completed.
+    struct alignas(8) Context {
+        HttpConnection::Handle connection;
+        unsigned inFlight = 0;
+        bool recvArmed = false;
+        bool sendArmed = false;
+        bool pollArmed = false;
+        bool closing = false;
+        struct iovec iov[TransportSocket::MAX_SEND_BUFFERS];
+        struct msghdr msg;
+    };
+
+    using ContextMap = std::unordered_map<SocketFd, std::unique_ptr<Context>>;
+
+    TcpListener& _listener;
+    std::string _webRootPath;
+    bool _verboseModeOn = false;
+    std::ostream& _logger;
+    HttpTimeouts _timeouts;
+
+    IoUring::Handle _ring;
+    struct __kernel_timespec _backoff; // delay of accept after errors
+    TimerWheel _timers; // outlives the connections
+    ContextMap _connections;
+
+    void onCompletion(const IoUring::Completion& cqe);
+    void onAccept(const IoUring::Completion& cqe);
+    void onRecv(Context& ctx, const IoUring::Completion& cqe);
+
+    // Registers a new connection and starts receiving from it
+    void addConnection(TcpSocket::Handle handle);
+
+    // Submits the next operation a connection is waiting for
+    void service(Context& ctx);
+
+    bool submitAccept();
+
+    // Submits the accept operation again after a delay, so that an
+    // error which persists (e.g. descriptors exhausted) is retried
+    // at a limited rate
+    bool submitAcceptBackoff();
+    bool submitRecv(Context& ctx);
+    bool submitSend(Context& ctx, const TransportSocket::Buffer* buffers,
+        int count, int flags);
+    bool submitPoll(Context& ctx);
+
+    // Closes the connections exceeding their time limits
+    void expireConnections();
+
+    // Shuts a connection down, releasing it once its pending
+    // operations are completed
+    void closeConnection(Context& ctx);
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_IO_URING_SUPPORT
+
+#endif // __HTTP_URING_REACTOR_H__
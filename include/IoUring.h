@@ -0,0 +1,200 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file IoUring.h
+///\brief Asynchronous I/O submission and completion rings (Linux io_uring)
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __IO_URING_H__
+#define __IO_URING_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#ifdef HTTP_SERVER_IO_URING_SUPPORT
+
+#include "TransportSocket.h"
+
+#include <linux/io_uring.h>
+
+#include <cstdint>
+#include <memory>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Wraps an io_uring instance: I/O operations are described by
+ * submission entries, queued and submitted to the kernel in batches,
+ * and their results are reaped from the completion queue.
+ * The ring can also provide the kernel with a pool of receive buffers
+ * (provided buffer ring), which is selected by recv operations when
+ * data arrives rather than when the operation is submitted.
+ * The object is not thread-safe: it is meant to be used by a single
+ * event loop.
+ */
+class IoUring {
+public:
+    using Handle = std::unique_ptr<IoUring>;
+    using Submission = io_uring_sqe;
+    using Completion = io_uring_cqe;
+    using TimeoutInterval = TransportSocket::TimeoutInterval;
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    ~IoUring();
+
+
+    /**
+     * Returns a handle to a new ring object.
+     *
+     * @param entries size of the submission queue
+     * @return the handle to a new ring object instance
+     */
+    static Handle create(unsigned entries = HTTP_URING_ENTRIES) {
+        return Handle(new IoUring(entries));
+    }
+
+
+    /**
+     * Returns true if the ring has been set up, false otherwise
+     * (e.g. io_uring is not supported or it is disabled by the system).
+     */
+    bool isValid() const noexcept {
+        return _ringFd >= 0;
+    }
+
+
+    /**
+     * Returns true if an operation is supported by the running kernel.
+     *
+     * @param opcode the operation code (IORING_OP_...)
+     */
+    bool isSupported(unsigned opcode) const noexcept;
+
+
+    /**
+     * Returns a new submission entry, cleared. The entry is submitted by
+     * the next call to submitAndWait(), or earlier if the queue is full.
+     *
+     * @return the entry, nullptr if the submission queue is full and
+     *         it cannot be submitted
+     */
+    Submission* getSubmission() noexcept;
+
+
+    /**
+     * Submits the queued entries and waits for at least one completion.
+     *
+     * @param timeout The time-out value
+     * @return zero on success or if the time limit expired,
+     *         -1 if an error occurred
+     */
+    int submitAndWait(const TimeoutInterval& timeout) noexcept;
+
+
+    /**
+     * Calls a handler for each available completion, then releases
+     * the completions to the kernel.
+     *
+     * @param handler a callable object taking a const Completion&
+     */
+    template <class Handler>
+    void forEachCompletion(Handler handler) {
+        unsigned head = *_cqHead;
+        const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; ++head)
+            handler(_cqes[head & *_cqMask]);
+
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    }
+
+
+    /**
+     * Registers a pool of receive buffers with the kernel.
+     *
+     * @param groupId the buffer group selected by recv operations
+     * @param count the number of buffers, a power of 2
+     * @param size the size in bytes of each buffer
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool setupBufferRing(uint16_t groupId, unsigned count, unsigned size);
+
+
+    /**
+     * Returns the data of a receive buffer selected by the kernel.
+     *
+     * @param id the buffer identifier reported by the completion
+     */
+    const char* getBuffer(uint16_t id) const noexcept {
+        return _buffers.get() + size_t(id) * _bufferSize;
+    }
+
+
+    /**
+     * Gives a receive buffer back to the kernel, once its data has
+     * been consumed.
+     *
+     * @param id the buffer identifier reported by the completion
+     */
+    void recycleBuffer(uint16_t id) noexcept;
+
+private:
+    int _ringFd = -1;
+    unsigned _features = 0;
+
+    void* _sqRing = nullptr;
+    size_t _sqRingSize = 0;
+    void* _cqRing = nullptr;
+    size_t _cqRingSize = 0;
+    Submission* _sqes = nullptr;
+    size_t _sqesSize = 0;
+
+    unsigned* _sqHead = nullptr;
+    unsigned* _sqTail = nullptr;
+    unsigned* _sqMask = nullptr;
+    unsigned _sqEntries = 0;
+    unsigned _sqLocalTail = 0; // entries queued, not published yet
+
+    unsigned* _cqHead = nullptr;
+    unsigned* _cqTail = nullptr;
+    unsigned* _cqMask = nullptr;
+    Completion* _cqes = nullptr;
+
+    std::unique_ptr<uint8_t[]> _probe;
+
+    io_uring_buf_ring* _bufRing = nullptr;
+    size_t _bufRingSize = 0;
+    std::unique_ptr<char[]> _buffers;
+    unsigned _bufferCount = 0;
+    unsigned _bufferSize = 0;
+    uint16_t _bufTail = 0;
+
+    explicit IoUring(unsigned entries);
+
+    bool mapRings(const io_uring_params& params);
+
+    // Publishes the queued entries and submits them to the kernel
+    int enter(unsigned minComplete, unsigned flags,
+        const void* arg = nullptr, size_t argSize = 0) noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // HTTP_SERVER_IO_URING_SUPPORT
+
+#endif // __IO_URING_H__
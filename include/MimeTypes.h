@@ -0,0 +1,78 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file MimeTypes.h
+///\brief Resolution of MIME types from file extensions
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __MIME_TYPES_H__
+#define __MIME_TYPES_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Maps file extensions to MIME types.
+ * The built-in types are a constant table sorted at compile time,
+ * searched without any allocation. Types can be added or overridden
+ * at startup by loading a mime.types file.
+ */
+class MimeTypes {
+public:
+    enum { MAX_EXT_LEN = 16 };
+
+    static constexpr const char* DEFAULT_TYPE = "application/octet-stream";
+
+    MimeTypes() = delete;
+
+
+    /**
+     * Returns the MIME type of a file extension.
+     *
+     * @param ext The extension, with or without the leading dot;
+     *            the case of letters is ignored
+     * @return the MIME type, or DEFAULT_TYPE if the extension is unknown
+     */
+    static std::string_view lookup(std::string_view ext) noexcept;
+
+
+    /**
+     * Loads additional types from a file in mime.types format, i.e.
+     * lines made of a MIME type followed by its extensions. Text
+     * following a '#' is ignored. Loaded types take precedence over
+     * the built-in ones.
+     * This function is not thread-safe: it is meant to be called
+     * before the server starts.
+     *
+     * @param fileName the path of the file
+     * @return true if operation successfully completed, false otherwise
+     */
+    static bool load(const std::string& fileName);
+
+private:
+    // Sorted by extension
+    static std::vector<std::pair<std::string, std::string>> _overrides;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __MIME_TYPES_H__
@@ -68,6 +68,20 @@ public:
         return Handle(new TcpListener());
     }
 
+    ~TcpListener();
+
+
+    /**
+     * Allows other listeners to bind the same address and port
+     * (SO_REUSEPORT): the kernel distributes the incoming connections
+     * among all of them. It must be called before bind().
+     *
+     * @param on true to enable the option, false to disable it
+     * @return false if operation fails or it is not supported on this
+     *         platform, true otherwise
+     */
+    bool setReusePort(bool on = true) noexcept;
+
 
     /**
      * Associates a local IPv4 address and TCP port with this
@@ -103,19 +117,62 @@ public:
 
     /**
      * Extracts the first connection on the queue of pending connections,
-     * and creates a new tcp connection handle
+     * and creates a new tcp connection handle.
+     * When the process runs out of file descriptors, the pending 
+     * connection is accepted and immediately closed by using a 
+     * descriptor reserved for this purpose, so that the client is 
+     * not left waiting in the queue.
+     *
+     * @param nonBlocking true to put the new connection in non-blocking
+     *        mode, false to put it in blocking mode
+     * @return an handle to a new tcp connection, or an empty handle in
+     *         case of failure: errno is then EAGAIN/EWOULDBLOCK if the
+     *         listener is non-blocking and no connection is pending,
+     *         ECONNABORTED if the connection was dropped (including
+     *         the case of descriptors exhausted), or any other error 
+     *         reported by accept()
+     */
+    TcpSocket::Handle accept(bool nonBlocking = false);
+
+
+    /**
+     * Creates a tcp connection handle for a socket descriptor accepted
+     * on this listener by other means, e.g. by an asynchronous accept
+     * operation. The handle takes the ownership of the descriptor.
      *
+     * @param sd the accepted socket descriptor
      * @return an handle to a new tcp connection
      */
-    TcpSocket::Handle accept();
+    TcpSocket::Handle adopt(SocketFd sd);
+
+
+    /**
+     * Returns the number of connections accepted so far.
+     */
+    uint64_t getAcceptCount() const noexcept {
+        return _acceptCount.load(std::memory_order_relaxed);
+    }
 
 private:
     std::atomic<Status> _status;
+    std::atomic<uint64_t> _acceptCount;
 
     TranspPort _port = 0;
     sockaddr_in _local_ip_port_sa_in;
 
+    // Descriptor released to accept and close a connection
+    // when file descriptors are exhausted
+    int _reservedFd = -1;
+
     TcpListener();
+
+    // Accepts a pending connection, returns its descriptor or -1
+    SocketFd acceptFd(sockaddr* remote_sockaddr, bool nonBlocking) noexcept;
+
+    // Drops a pending connection by using the reserved descriptor
+    bool dropConnection() noexcept;
+
+    void openReservedFd() noexcept;
 };
 
 
@@ -0,0 +1,121 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file ThreadPool.h
+///\brief Fixed-size pool of worker threads with work stealing
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Executes tasks on a fixed set of worker threads.
+ * Each worker owns a deque of tasks: it pops the most recently
+ * pushed task from the back of its own deque and, when that is
+ * empty, steals the oldest task from the front of another worker's
+ * deque, so that a burst of tasks is quickly spread over all the
+ * workers.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+    using Handle = std::unique_ptr<ThreadPool>;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+
+    /**
+     * Stops the workers, waiting for running tasks to complete.
+     * Tasks not yet started are discarded.
+     */
+    ~ThreadPool();
+
+
+    /**
+     * Returns a handle to a new pool object.
+     *
+     * @param threads number of worker threads, zero means the number
+     *                of hardware threads
+     * @return the handle to a new pool object instance
+     */
+    static Handle create(size_t threads = 0) {
+        return Handle(new ThreadPool(threads));
+    }
+
+
+    /**
+     * Schedules a task for execution.
+     * A task submitted by a worker is queued on its own deque,
+     * otherwise workers deques are selected in round robin.
+     *
+     * @param task The task to execute
+     */
+    void submit(Task task);
+
+
+    /**
+     * Returns the number of worker threads
+     */
+    size_t size() const noexcept {
+        return _queues.size();
+    }
+
+
+    /**
+     * Returns the number of tasks waiting for a worker
+     */
+    size_t pendingTasks() const noexcept {
+        return _pending;
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
+    std::vector<std::thread> _workers;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::atomic<size_t> _pending;
+    std::atomic<size_t> _nextQueue;
+    bool _stop = false;
+
+    explicit ThreadPool(size_t threads);
+
+    void workerLoop(size_t index);
+    bool popTask(size_t index, Task& task);
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __THREAD_POOL_H__
@@ -0,0 +1,241 @@
+//
+// This file is part of thttpd
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+
+/* -------------------------------------------------------------------------- */
+
+///\file TimerWheel.h
+///\brief Hierarchical timer wheel
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Keeps track of a large number of timers, e.g. one per connection,
+ * scheduling and cancelling them in constant time.
+ * Time is divided in ticks. Timers expiring within the next 64 ticks
+ * are kept in the slot of their tick; later ones are kept by coarser
+ * levels, whose slots span 64 times the ones of the level below, and
+ * are moved down a level each time the wheel below completes a turn.
+ * Timers are embedded in the objects they belong to, so that neither
+ * scheduling nor cancelling allocates memory.
+ * The wheel is not thread-safe: it is meant to be owned by an event
+ * loop, along with the objects its timers belong to.
+ */
+class TimerWheel {
+    // Node of the circular list of a slot
+    struct Link {
+        Link* prev = nullptr;
+        Link* next = nullptr;
+    };
+
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using Duration = Clock::duration;
+
+    /**
+     * A timer, which can be scheduled on a wheel.
+     * It is cancelled when destroyed.
+     */
+    class Timer : private Link {
+    public:
+        /**
+         * Constructs a timer.
+         *
+         * @param context The object the timer belongs to,
+         *                @see getContext()
+         */
+        explicit Timer(void* context = nullptr) noexcept
+            : _context(context)
+        {}
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        ~Timer() {
+            cancel();
+        }
+
+        /**
+         * Returns the object the timer belongs to.
+         */
+        void* getContext() const noexcept {
+            return _context;
+        }
+
+        /**
+         * Returns true if the timer is scheduled and not expired yet.
+         */
+        bool isPending() const noexcept {
+            return _wheel != nullptr;
+        }
+
+        /**
+         * Cancels the timer, if pending.
+         */
+        void cancel() noexcept;
+
+    private:
+        friend class TimerWheel;
+
+        void* _context = nullptr;
+        TimerWheel* _wheel = nullptr;
+        uint64_t _expiry = 0; // tick
+    };
+
+
+    /**
+     * Constructs the wheel.
+     *
+     * @param resolution The duration of a tick
+     */
+    explicit TimerWheel(
+        Duration resolution = std::chrono::milliseconds(HTTP_TIMER_RESOLUTION));
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Pending timers are cancelled
+    ~TimerWheel();
+
+
+    /**
+     * Schedules a timer, cancelling it first if pending.
+     * The timer expires no earlier than the timeout, and no later
+     * than a tick after it (if the wheel is advanced in time).
+     *
+     * @param timer The timer
+     * @param timeout The time from now the timer expires at
+     * @param now The current time
+     */
+    void schedule(
+        Timer& timer, Duration timeout, TimePoint now = Clock::now()) noexcept;
+
+
+    /**
+     * Expires the timers due by now, calling a function for each of
+     * them. The function is allowed to schedule and cancel timers,
+     * including the expired one.
+     *
+     * @param now The current time
+     * @param onExpired The function, called as onExpired(Timer&)
+     */
+    template <class F> void advance(TimePoint now, F&& onExpired);
+
+
+    /**
+     * Returns the number of pending timers.
+     */
+    size_t size() const noexcept {
+        return _count;
+    }
+
+
+    /**
+     * Returns true if no timer is pending.
+     */
+    bool empty() const noexcept {
+        return _count == 0;
+    }
+
+
+    /**
+     * Returns the duration of a tick.
+     */
+    Duration getResolution() const noexcept {
+        return _resolution;
+    }
+
+private:
+    enum {
+        LEVEL_BITS = 6,
+        SLOTS = 1 << LEVEL_BITS,
+        LEVELS = 4
+    };
+
+    Duration _resolution;
+    TimePoint _origin;
+    uint64_t _tick = 0; // the earliest tick not expired yet
+    size_t _count = 0;
+    Link _slots[LEVELS][SLOTS];
+
+    // Puts a timer in the slot of its expiry
+    void insert(Timer& timer) noexcept;
+
+    // Moves the timers of a slot down to the levels below
+    void cascade(int level) noexcept;
+
+    // Removes a timer from its slot
+    static void unlink(Link& link) noexcept;
+
+    // Moves the timers of a slot into an empty list
+    static void splice(Link& from, Link& to) noexcept;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+template <class F> void TimerWheel::advance(TimePoint now, F&& onExpired)
+{
+    if (now < _origin)
+        return;
+
+    const uint64_t target = uint64_t((now - _origin) / _resolution);
+
+    // Nothing is going to expire meanwhile
+    if (!_count) {
+        _tick = std::max(_tick, target + 1);
+        return;
+    }
+
+    while (_tick <= target) {
+        // A level completing a turn refills the one below
+        for (int level = 1; level < LEVELS; ++level) {
+            if (_tick & ((uint64_t(1) << (LEVEL_BITS * level)) - 1))
+                break;
+
+            cascade(level);
+        }
+
+        Link expired;
+        splice(_slots[0][_tick & (SLOTS - 1)], expired);
+
+        // Timers scheduled by the callback expire from next tick on
+        ++_tick;
+
+        // Timers are taken one at a time, as the callback may cancel
+        // the other ones
+        while (expired.next != &expired) {
+            Timer& timer = static_cast<Timer&>(*expired.next);
+            timer.cancel();
+            onExpired(timer);
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __TIMER_WHEEL_H__
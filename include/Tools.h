@@ -16,6 +16,8 @@
 /* -------------------------------------------------------------------------- */
 
 #include <chrono>
+#include <cstdint>
+#include <ostream>
 #include <regex>
 #include <string>
 #include <time.h>
@@ -98,6 +100,21 @@ bool fileStat(const std::string& fileName, std::string& dateTime,
     std::string& ext, size_t& fsize);
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reads from a file descriptor at a given offset, without using
+ * nor changing the file position.
+ *
+ * @param fd Descriptor of a file open for reading
+ * @param buf The buffer receiving the data
+ * @param len The maximum number of bytes to read
+ * @param offset File offset of the first byte to read
+ * @return the number of bytes read, zero at end of file, -1 on error
+ */
+int64_t readFileAt(int fd, char* buf, size_t len, int64_t offset);
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -113,6 +130,19 @@ bool splitLineInTokens(const std::string& line,
     std::vector<std::string>& tokens, const std::string& sep);
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Writes a text to a stream shared by several threads, by a single
+ * write under a lock, and flushes the stream: the texts written by
+ * different threads are never interleaved.
+ *
+ * @param os The output stream
+ * @param text The text to write
+ */
+void writeLog(std::ostream& os, const std::string& text);
+
+
 } // namespace Tools
 
 
@@ -23,6 +23,10 @@
 #include <cstdint>
 #include <fstream>
 
+#ifdef HTTP_SERVER_SENDFILE_SUPPORT
+#include <sys/sendfile.h>
+#endif
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -37,6 +41,18 @@ public:
     enum class RecvEvent { RECV_ERROR, TIMEOUT, RECV_DATA };
     using TimeoutInterval = std::chrono::system_clock::duration;
 
+    /**
+     * Flag for send operations announcing that more data is going
+     * to follow: the data is held back (corked) so that it can be
+     * transmitted with the next write instead of in its own segment.
+     * It is zero where not supported.
+     */
+#ifdef MSG_MORE
+    static constexpr int SEND_MORE = MSG_MORE;
+#else
+    static constexpr int SEND_MORE = 0;
+#endif
+
 protected:
     /**
      * Construct a basic_socket on an existing native socket
@@ -83,6 +99,17 @@ public:
     RecvEvent waitForRecvEvent(const TimeoutInterval& timeout);
 
 
+    /**
+     * Determines the writability status of this socket, i.e. whether
+     * the socket can accept more data to be sent.
+     *
+     * @param timeout The time-out value.
+     * @return true if data can be sent, false if the time limit expired
+     *         or an error occurred
+     */
+    bool waitForSendEvent(const TimeoutInterval& timeout);
+
+
     /**
      * Returns the socket descriptor for this socket
      */
@@ -112,6 +139,35 @@ public:
     }
 
 
+    /**
+     * A buffer taking part in a gathered write
+     */
+    struct Buffer {
+        const char* data;
+        size_t size;
+    };
+
+    enum { MAX_SEND_BUFFERS = 64 };
+
+
+    /**
+     * Sends a sequence of buffers on a connected socket with a single
+     * call (gathered write), e.g. response headers and bodies, so that
+     * they can be transmitted in the same segments.
+     *
+     * @param buffers The buffers to send, in order
+     * @param count   The number of buffers, at most MAX_SEND_BUFFERS
+     * @param flags   A set of flags that specify the way in which the
+     *                call is made.
+     * @return      If no error occurs, sendv() returns the total number
+     *              of bytes sent, which can be less than the overall 
+     *              size of the buffers.
+     *              Otherwise, -1 is returned, and a specific error code
+     *              can be retrieved by calling errno
+     */
+    int64_t sendv(const Buffer* buffers, int count, int flags = 0) noexcept;
+
+
     /**
      * Receives data from a connected socket
      *
@@ -149,20 +205,73 @@ public:
 
 
     /**
-     * Sends a file on a connected socket
+     * Sends the content of an open file on a connected socket.
+     * The file descriptor position is neither used nor modified,
+     * so the descriptor can be shared among connections.
      *
-     * @param filepath String containing the path of existing file
-     * @return      If no error occurs, send() returns the total number
-     *              of bytes sent, which can be less than the number
-     *              requested to be sent in the len parameter.
+     * @param fd    Descriptor of a file open for reading
+     * @param offset File offset of the first byte to send; the bytes
+     *              which precede it are not read
+     * @param size  The number of bytes to send
+     * @return      If no error occurs, sendFile() returns the total number
+     *              of bytes sent.
      *              Otherwise, -1 is returned, and a specific error code
      *              can be retrieved by errno
      */
-    int sendFile(const std::string& filepath) noexcept;
+    int64_t sendFile(int fd, int64_t offset, int64_t size) noexcept;
+
+
+#ifdef HTTP_SERVER_SENDFILE_SUPPORT
+    /**
+     * Sends a portion of an open file on a connected socket, without
+     * copying the content through user space.
+     *
+     * @param fd     Descriptor of a file open for reading
+     * @param offset File offset of the first byte to send, it is
+     *               advanced by the number of bytes sent
+     * @param count  The number of bytes to send
+     * @return      If no error occurs, sendFile() returns the number
+     *              of bytes sent, which can be less than count.
+     *              Otherwise, -1 is returned, and a specific error code
+     *              can be retrieved by errno
+     */
+    ssize_t sendFile(int fd, off_t& offset, size_t count) noexcept {
+        return ::sendfile(getSocketFd(), fd, &offset, count);
+    }
+#endif
+
+
+    /**
+     * Enables or disables the non-blocking mode of this socket.
+     * In non-blocking mode send/recv/accept operations never block
+     * the caller and fail with EAGAIN/EWOULDBLOCK when they cannot
+     * be completed immediately.
+     *
+     * @param on true to enable non-blocking mode, false to disable it
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool setNonBlockingMode(bool on = true) noexcept;
+
+
+    /**
+     * Sets how long a send operation may wait for the remote peer
+     * to accept any data, before failing with EAGAIN/EWOULDBLOCK.
+     * It applies to blocking mode, and to sendFile(fd, offset, size)
+     * in non-blocking mode as well.
+     *
+     * @param timeout The time-out value
+     * @return true if operation successfully completed, false otherwise
+     */
+    bool setSendTimeout(const TimeoutInterval& timeout) noexcept;
 
 private:
     SocketFd _socket = 0;
+    TimeoutInterval _sendTimeout = std::chrono::seconds(HTTP_SEND_TIMEOUT);
     enum { TX_BUFFER_SIZE = HTTP_SERVER_TX_BUF_SIZE };
+
+    // Waits for the given poll events; returns the events occurred,
+    // 0 on timeout or -1 on error
+    int waitForEvents(short events, const TimeoutInterval& timeout);
 };
 
 
@@ -30,7 +30,62 @@
 #define HTTP_SERVER_MIN_V 0
 #define HTTP_SERVER_TX_BUF_SIZE 0x100000
 #define HTTP_SERVER_BACKLOG SOMAXCONN
-#define HTTP_CONNECTION_TIMEOUT 120 //secs
+#define HTTP_SERVER_ACCEPT_BACKOFF 10 // msecs
+#define HTTP_IDLE_TIMEOUT 120 // secs, keep-alive connection without requests
+#define HTTP_HEADER_TIMEOUT 30 // secs, to receive a whole request header
+#define HTTP_SEND_TIMEOUT 60 // secs, without any byte sent to the client
+#define HTTP_TIMER_RESOLUTION 100 // msecs
+#define HTTP_SERVER_THREADS 0 // number of hardware threads
+#define HTTP_SERVER_LISTENER_SHARDS 1 // 0 means number of hardware threads
+#define HTTP_SERVER_MAX_HEADER_SIZE 0x2000
+#define HTTP_SERVER_MAX_HEADER_FIELDS 64
+#define HTTP_SERVER_RX_BUF_SIZE 0x1000
+#define HTTP_SERVER_PIPELINE_DEPTH 16 // responses queued before a write
+#define HTTP_ARENA_BLOCK_SIZE 0x2000
+#define HTTP_ARENA_POOL_BLOCKS 64 // free arena blocks kept by each thread
+#define HTTP_REACTOR_MAX_EVENTS 256
+#define HTTP_URING_ENTRIES 1024
+#define HTTP_URING_BUFFERS 256 // receive buffers per ring, power of 2
+#define HTTP_FILE_CACHE_ENTRIES 256
+#define HTTP_FILE_CACHE_TTL 5 //secs
+#define HTTP_CONTENT_CACHE_SIZE 0x2000000
+#define HTTP_CONTENT_CACHE_ENTRY_SIZE 0x40000
+#define HTTP_GZIP_CACHE_SIZE 0x1000000
+#define HTTP_GZIP_MIN_SIZE 256 // smaller files are not compressed
+#define HTTP_GZIP_MAX_SIZE 0x400000 // nor larger ones
+#define HTTP_GZIP_LEVEL 6
+#define HTTP_STATS_PATH "" // metrics URI (e.g. "/__stats"), empty disables
+#define HTTP_ACCESS_LOG_RING_SIZE 1024 // records per thread, power of 2
+#define HTTP_ACCESS_LOG_FLUSH_INTERVAL 100 // msecs
+
+// HTTP_SERVER_ZLIB_SUPPORT is defined by the build system when zlib
+// is available, enabling on-the-fly compression
+
+// Request headers are scanned by SSE2 instructions on x86 processors,
+// AVX2 ones are used when the processor turns out to support them
+#if defined(__GNUC__) && defined(__SSE2__)
+#define HTTP_SERVER_SSE2_SUPPORT
+#define HTTP_SERVER_AVX2_SUPPORT
+#endif
+
+#ifdef __linux__
+#define HTTP_SERVER_EPOLL_SUPPORT
+#define HTTP_SERVER_SENDFILE_SUPPORT
+#define HTTP_SERVER_REUSEPORT_SUPPORT
+#define HTTP_SERVER_ACCEPT4_SUPPORT
+
+// io_uring is used through the kernel interface, the multishot 
+// operations require the definitions of Linux 6.0 or later
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IORING_RECV_MULTISHOT
+#define HTTP_SERVER_IO_URING_SUPPORT
+#endif
+#endif
+#endif
+
+#endif
 
 #endif // __HTTP_CONFIG_H__
 